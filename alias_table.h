@@ -0,0 +1,72 @@
+/*
+Walker's alias method (Vose's construction): draws index i of n with
+probability weight[i] / sum of all weights in O(1), with one uniform index
+and one uniform real per draw, whatever the weights are.
+
+Each entry holds a threshold and an alias: draw an entry uniformly, then keep
+it if a uniform real is below its threshold, otherwise take its alias.
+Building is O(n).
+*/
+
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "rng.h"
+
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    // The weights must not be negative; all zero draws uniformly.
+    AliasTable(const float* weights, uint32_t n) : m_entries(n) {
+        double total = 0;
+        for (uint32_t i = 0; i < n; ++i) total += weights[i];
+        m_total = total;
+        if (n == 0) return;
+
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (uint32_t i = 0; i < n; ++i) {
+            scaled[i] = total > 0 ? weights[i] * n / total : 1;
+            (scaled[i] < 1 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            m_entries[s] = Entry{ float(scaled[s]), l };
+            scaled[l] -= 1 - scaled[s];
+            if (scaled[l] < 1) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // what is left is 1 up to rounding
+        for (uint32_t i : large) m_entries[i] = Entry{ 1, i };
+        for (uint32_t i : small) m_entries[i] = Entry{ 1, i };
+    }
+
+    uint32_t size() const { return m_entries.size(); }
+    double total() const { return m_total; }  // sum of the weights
+
+    template <class Rng>
+    uint32_t operator()(Rng& rng) const {
+        uint32_t i = random_below(rng, m_entries.size());
+        const Entry& e = m_entries[i];
+        return random_real(rng, 0, 1) < e.threshold ? i : e.alias;
+    }
+
+private:
+    struct Entry {
+        float threshold = 1;
+        uint32_t alias = 0;
+    };
+
+    std::vector<Entry> m_entries;
+    double m_total = 0;
+};
+
+#endif // ALIAS_TABLE_H
@@ -0,0 +1,481 @@
+/*
+Benchmarks of the generators (see generators.h), with fixed seeds so that two
+runs (or two builds) measure exactly the same work:
+
+ load      : reading the dictionary, including the pattern index; also
+             checks that a binary dictionary of its words with a flipped
+             byte fails the verified load, and one with a corrupt bucket
+             table every load
+ ingest    : the dictionary as index_adder -b reads it (word_ingester.h);
+             also checks that an input whose size is a multiple of the chunk
+             size yields the same words
+ can_place : placement tests of the letters table approach, ns per call,
+             also on the fixed size grids (see grid_dims.h) for 15 and 30
+ pattern   : draws of words matching patterns with 1 to 3 fixed letters,
+             ns per call, without and with the pattern cache (pattern_cache.h)
+ doWeight  : placement tests of the weight approach, ns per call, and
+             highestWeight, the whole-grid search built on it, us per call
+ rollback  : taking back a whole generation, by undo log and by snapshot
+ fill      : time to fill an open 5x5 and a blocked 7x7 template, and
+             the words tried per second, without and with the pattern cache
+ generate  : time to a finished grid, words placed per second and fill
+             density (letter cells / all cells), for the letters table
+             approach (also with random tries, as the dutch variant did,
+             and with reseeding of empty regions) and the weight approach;
+             the letters table approach and its tiled version (see
+             tiled_generator.h) also for 512 and 1024, the latter on all cores
+
+for grid sizes 15, 30, 64 and 128. Every case is repeated --reps times and
+reported as median, 90th and 99th percentile.
+
+Built with -DCWG_INSTRUMENT, --stats json|prometheus dumps the counters of
+the whole run to stderr at the end (see instrumentation.h); the timings are
+then those of the instrumented build.
+
+Usage: benchmark [dictionary] [--reps N] [--seed S] [--stats FORMAT]
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "generators.h"
+#include "word_ingester.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const vector<int> GridSizes  = { 15, 30, 64, 128 };
+const vector<int> LargeSizes = { 512, 1024 };  // letters and tiled
+const int ShortestWord = 3, LongestWord = 8;
+const string WordFile = "wordlist.txt";
+const int CallsPerSample = 100000;  // placement tests timed as one sample
+
+volatile long Sink;  // keeps the results of timed calls alive
+
+double seconds_since(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+class Samples {
+public:
+    void add(double x) { m_v.push_back(x); }
+    double pct(double p) {
+        if (m_v.empty()) return 0;
+        sort(m_v.begin(), m_v.end());
+        return m_v[min(m_v.size() - 1, size_t(p / 100 * m_v.size()))];
+    }
+    size_t size() const { return m_v.size(); }
+private:
+    vector<double> m_v;
+};
+
+void report(const string& name, const string& unit, Samples& s) {
+    printf("%-34s %5zu %12.3f %12.3f %12.3f  %s\n", name.c_str(), s.size(),
+           s.pct(50), s.pct(90), s.pct(99), unit.c_str());
+}
+
+/* Letter cells and words of a puzzle. The generators keep words apart, so
+ * every run of two or more letters is a word.
+ */
+struct Layout {
+    int cells = 0, letters = 0, words = 0;
+    double density() const { return cells ? double(letters) / cells : 0; }
+};
+
+Layout layout(const Puzzle& puzzle) {
+    Layout l;
+    const int height = puzzle.height(), width = puzzle.width();
+    auto letter = [&](int r, int c) { return isalpha((unsigned char)puzzle[r][c]) != 0; };
+    l.cells = width * height;
+    for (int horz = 1; horz >= 0; --horz)
+        for (int line = 0; line < (horz ? height : width); ++line)
+            for (int i = 0, run = 0; i <= (horz ? width : height); ++i) {
+                bool in = i < (horz ? width : height)
+                       && (horz ? letter(line, i) : letter(i, line));
+                if (in) { ++run; if (horz) ++l.letters; continue; }
+                if (run >= 2) ++l.words;
+                run = 0;
+            }
+    return l;
+}
+
+// The words of 'text' by WordIngester, in chunks of 'chunk_size' on 'threads' threads.
+vector<string> ingest(const string& text, size_t chunk_size, unsigned threads) {
+    WordIngester::Options options;
+    options.non_alpha  = WordIngester::Drop;
+    options.chunk_size = chunk_size;
+    options.threads    = threads;
+    WordIngester ingester(options);
+    istringstream in(text);
+    ingester.ingest(in);
+    return ingester.buckets();
+}
+
+void bench_ingest(const string& file, int reps) {
+    ifstream in(file, ios::binary);
+    if (!in) throw runtime_error("Cannot open " + file);
+    string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (text.empty() || text.back() != '\n') text += '\n';
+    Samples ms;
+    vector<string> words;
+    for (int r = 0; r < reps; ++r) {
+        auto start = Clock::now();
+        words = ingest(text, WordIngester::Options().chunk_size, 2);
+        ms.add(seconds_since(start) * 1e3);
+    }
+    report("ingest", "ms", ms);
+    // the last read returns nothing: all chunks are full
+    for (unsigned threads : { 1u, 2u })
+        for (size_t chunk_size : { text.size(), text.size() / 2 })
+            if (text.size() % chunk_size == 0 && ingest(text, chunk_size, threads) != words)
+                throw runtime_error("ingest: words lost with chunk size " + to_string(chunk_size));
+}
+
+void bench_load(const string& file, int reps) {
+    Samples range, all;
+    for (int r = 0; r < reps; ++r) {
+        auto start = Clock::now();
+        WordList list(file, ShortestWord, LongestWord);
+        range.add(seconds_since(start) * 1e3);
+        Sink = list.size();
+
+        start = Clock::now();
+        WordList full(file, 1, DictMaxWordLength);
+        all.add(seconds_since(start) * 1e3);
+        Sink = full.size();
+    }
+    report("load WordList " + to_string(ShortestWord) + ".." + to_string(LongestWord),
+           "ms", range);
+    report("load WordList", "ms", all);
+}
+
+/* Writes the words of 'file' as binary dictionary, and loads copies with a
+ * flipped letter, which only the checksum tells, and with corrupt bucket
+ * tables, which no load may accept.
+ */
+void check_binary(const string& file) {
+    const WordList words(file, 1, DictMaxWordLength);
+    vector<string> buckets(DictMaxWordLength);
+    for (uint32_t id = 0; id < words.size(); ++id) {
+        string_view word = words.word_view(id);
+        buckets[word.size() - 1] += word;
+    }
+    char path[] = "/tmp/cwg_checkXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) throw runtime_error("Cannot create a temporary file");
+    ::close(fd);
+    ostringstream out;
+    write_binary_dictionary(out, buckets);
+    const string intact = out.str();
+    DictBucket first_buckets[2];
+    memcpy(first_buckets, intact.data() + sizeof(DictHeader), sizeof(first_buckets));
+
+    // writes the dictionary with 'value' at 'offset', and tries to load it
+    auto loads = [&](size_t offset, const void* value, size_t size, bool verify) {
+        string data = intact;
+        memcpy(&data[offset], value, size);
+        ofstream(path, ios::binary).write(data.data(), data.size());
+        try {
+            MappedDictionary dict(path, verify);
+            return true;
+        }
+        catch (const runtime_error&) {
+            return false;
+        }
+    };
+    auto field = [](size_t bucket, size_t member) {
+        return sizeof(DictHeader) + bucket * sizeof(DictBucket) + member * sizeof(uint32_t);
+    };
+    const char flipped = intact.back() ^ 1;
+    const uint32_t in_header = 0, word_count = words.size() + 1,
+                   same_length = first_buckets[0].length, gap = first_buckets[1].first + 1;
+    const char* failure =
+        !loads(0, intact.data(), 1, true)                               ? "intact file rejected"
+      : !loads(intact.size() - 1, &flipped, 1, false)                   ? "flipped letter rejected without checksum"
+      : loads(intact.size() - 1, &flipped, 1, true)                     ? "flipped letter not detected"
+      : loads(field(0, 3), &in_header, 4, false)                        ? "words in the header accepted"
+      : loads(offsetof(DictHeader, word_count), &word_count, 4, false)  ? "wrong word count accepted"
+      : loads(field(1, 0), &same_length, 4, false)                      ? "repeated length accepted"
+      : loads(field(1, 1), &gap, 4, false)                              ? "gap in the ids accepted"
+      : nullptr;
+    ::unlink(path);
+    if (failure) throw runtime_error(string("binary dictionary: ") + failure);
+}
+
+void bench_generate(const Generator& generator, const string& name,
+                    GeneratorParams params, uint64_t seed, int reps,
+                    const vector<int>& sizes = GridSizes) {
+    for (int size : sizes) {
+        params.width = params.height = size;
+        Samples ms, words_per_s, density;
+        for (int r = 0; r < reps; ++r) {
+            auto rng = puzzle_rng(seed, r);
+            Puzzle puzzle;
+            auto start = Clock::now();
+            generator.generate(params, rng, puzzle);
+            double s = seconds_since(start);
+            Layout l = layout(puzzle);
+            ms.add(s * 1e3);
+            words_per_s.add(l.words / s);
+            density.add(l.density() * 100);
+        }
+        string prefix = name + " " + to_string(size);
+        report(prefix + " time", "ms", ms);
+        report(prefix + " words placed", "words/s", words_per_s);
+        report(prefix + " density", "%", density);
+    }
+}
+
+// BasicGrid::can_place at random points of a finished grid.
+template <class Dims>
+Samples can_place_samples(const WordList& wordlist, const GeneratorParams& params,
+                          uint64_t seed, int reps) {
+    const int size = params.width;
+    Samples place;
+    for (int r = 0; r < reps; ++r) {
+        auto rng = puzzle_rng(seed, r);
+        BasicGrid<Dims> grid(wordlist, params, rng);
+        grid.generate();
+
+        uniform_int_distribution<> pos(0, size - 1), len(ShortestWord, LongestWord);
+        vector<Point> points;
+        vector<pair<int, int>> slots;
+        for (int i = 0; i < 1024; ++i) {
+            points.emplace_back(pos(rng), pos(rng), Dir(i & 1 ? Dir::Horz : Dir::Vert));
+            int l = len(rng);
+            slots.emplace_back(l, uniform_int_distribution<>(0, l - 1)(rng));
+        }
+        long fits = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < CallsPerSample; ++i)
+            fits += grid.can_place(slots[i & 1023].first, slots[i & 1023].second,
+                                   points[(i * 7) & 1023]);
+        place.add(seconds_since(start) * 1e9 / CallsPerSample);
+        Sink = fits;
+    }
+    return place;
+}
+
+// The runtime sized grid, and the fixed size ones LettersGenerator uses for 15 and 30.
+void bench_can_place(const WordList& wordlist, uint64_t seed, int reps) {
+    for (int size : GridSizes) {
+        GeneratorParams params;
+        params.width = params.height = size;
+        params.shortest = ShortestWord;
+        params.longest  = LongestWord;
+        string name = "letters " + to_string(size) + " can_place";
+        auto place = can_place_samples<RuntimeDims>(wordlist, params, seed, reps);
+        report(name, "ns/call", place);
+        if (size == 15) {
+            place = can_place_samples<FixedDims<15, 15>>(wordlist, params, seed, reps);
+            report(name + " fixed", "ns/call", place);
+        }
+        if (size == 30) {
+            place = can_place_samples<FixedDims<30, 30>>(wordlist, params, seed, reps);
+            report(name + " fixed", "ns/call", place);
+        }
+    }
+}
+
+/* Draws matching patterns with 1, 2 and 3 fixed letters, taken from random
+ * words, without and with the pattern cache (warmed up by one pass).
+ */
+void bench_pattern(const WordList& wordlist, const WordList& cached, uint64_t seed, int reps) {
+    const int Calls = CallsPerSample / 10;
+    for (int fixed = 1; fixed <= 3; ++fixed) {
+        Samples plain, hit;
+        for (int r = 0; r < reps; ++r) {
+            auto rng = puzzle_rng(seed, r);
+            vector<string> patterns;
+            for (int i = 0; i < 1024; ++i) {
+                uint32_t id = 0;
+                wordlist.rnd_word(rng, ShortestWord, LongestWord, id);
+                string word = wordlist.word(id), pattern(word.size(), '?');
+                for (int k = 0; k < fixed; ++k) {
+                    size_t pos = random_below(rng, word.size());
+                    pattern[pos] = word[pos];
+                }
+                patterns.push_back(pattern);
+            }
+            for (const WordList* words : { &wordlist, &cached }) {
+                uint32_t id;
+                long found = 0;
+                for (const auto& pattern : patterns) found += words->pick(pattern, rng, id);
+                auto start = Clock::now();
+                for (int i = 0; i < Calls; ++i) found += words->pick(patterns[i & 1023], rng, id);
+                (words == &wordlist ? plain : hit).add(seconds_since(start) * 1e9 / Calls);
+                Sink = found;
+            }
+        }
+        string name = "pattern " + to_string(fixed) + " fixed pick";
+        report(name, "ns/call", plain);
+        report(name + " cached", "ns/call", hit);
+    }
+}
+
+// Template fills; the cached list keeps its cache from rep to rep, as the server does.
+void bench_fill(const WordList& wordlist, const WordList& cached, uint64_t seed, int reps) {
+    const vector<vector<string>> templates = {
+        vector<string>(5, "....."),
+        { "...#...", "...#...", ".......", "###.###", ".......", "...#...", "...#..." },
+    };
+    for (const auto& rows : templates) {
+        for (const WordList* words : { &wordlist, &cached }) {
+            Samples ms, nodes_per_s;
+            for (int r = 0; r < reps; ++r) {
+                auto rng = puzzle_rng(seed, r);
+                FillEngine engine(*words, rows);
+                auto start = Clock::now();
+                Sink = engine.fill(rng);
+                double s = seconds_since(start);
+                ms.add(s * 1e3);
+                nodes_per_s.add(engine.nodes() / s);
+            }
+            string name = "fill " + to_string(rows[0].size()) + "x" + to_string(rows.size())
+                        + (words == &cached ? " cached" : "");
+            report(name + " time", "ms", ms);
+            report(name + " words tried", "words/s", nodes_per_s);
+        }
+    }
+}
+
+// Taking back a whole generation with Grid::rollback, and Grid::restore of a snapshot.
+void bench_rollback(const WordList& wordlist, uint64_t seed, int reps) {
+    for (int size : GridSizes) {
+        GeneratorParams params;
+        params.width = params.height = size;
+        params.shortest = ShortestWord;
+        params.longest  = LongestWord;
+        Samples rollback, restore;
+        for (int r = 0; r < reps; ++r) {
+            auto rng = puzzle_rng(seed, r);
+            Grid grid(wordlist, params, rng);
+            auto empty = grid.snapshot();
+            size_t checkpoint = grid.checkpoint();
+            grid.generate();
+            auto start = Clock::now();
+            grid.rollback(checkpoint);
+            rollback.add(seconds_since(start) * 1e6);
+
+            grid.generate();
+            start = Clock::now();
+            grid.restore(empty);
+            restore.add(seconds_since(start) * 1e6);
+        }
+        string name = "letters " + to_string(size);
+        report(name + " rollback", "us", rollback);
+        report(name + " restore", "us", restore);
+    }
+}
+
+// Cwg::doWeight at random valid positions of a finished grid, and highestWeight.
+void bench_do_weight(const WordList& wordlist, uint64_t seed, int reps) {
+    for (int size : GridSizes) {
+        Samples weight, highest;
+        const int rounds = size * size / 9;
+        for (int r = 0; r < reps; ++r) {
+            auto rng = puzzle_rng(seed, r);
+            Cwg cwg{size, size};
+            for (int i = 0; i < rounds; ++i) {
+                cwg.emplaceWord(wordlist.rnd_word(rng), true);
+                cwg.emplaceWord(wordlist.rnd_word(rng), false);
+            }
+
+            vector<string_view> words;
+            vector<int> xs, ys;
+            for (int i = 0; i < 1024; ++i) {
+                string_view word;
+                do word = wordlist.rnd_word(rng); while (int(word.size()) > size - 2);
+                bool horz = i & 1;
+                int w = horz ? size - word.size() - 1 : size - 2;
+                int h = horz ? size - 2 : size - word.size() - 1;
+                xs.push_back(uniform_int_distribution<>(1, max(w, 1))(rng));
+                ys.push_back(uniform_int_distribution<>(1, max(h, 1))(rng));
+                words.push_back(word);
+            }
+            long wt = 0;
+            auto start = Clock::now();
+            for (int i = 0; i < CallsPerSample; ++i) {
+                int k = (i * 7) & 1023;
+                wt += cwg.doWeight(words[k], xs[k], ys[k], k & 1, !(k & 1)).wt;
+            }
+            weight.add(seconds_since(start) * 1e9 / CallsPerSample);
+
+            const int calls = 200;
+            start = Clock::now();
+            for (int i = 0; i < calls; ++i)
+                wt += cwg.highestWeight(words[i], i & 1, !(i & 1)).wt;
+            highest.add(seconds_since(start) * 1e6 / calls);
+            Sink = wt;
+        }
+        string name = "weight " + to_string(size);
+        report(name + " doWeight", "ns/call", weight);
+        report(name + " highestWeight", "us/call", highest);
+    }
+}
+
+int main(int argc, char **argv) {
+    string wordFile = WordFile;
+    int reps = 20;
+    uint64_t seed = 1;
+    string stats;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc)       reps = max(stoi(argv[++i]), 1);
+        else if (arg == "--seed" && i + 1 < argc)  seed = stoull(argv[++i]);
+        else if (arg == "--stats" && i + 1 < argc) stats = argv[++i];
+        else                                       wordFile = arg;
+    }
+
+    try {
+        printf("%-34s %5s %12s %12s %12s\n", "case", "n", "median", "p90", "p99");
+        bench_load(wordFile, reps);
+        check_binary(wordFile);
+        bench_ingest(wordFile, reps);
+        const WordList wordlist(wordFile, ShortestWord, LongestWord);
+        GeneratorParams params;
+        params.shortest = ShortestWord;
+        params.longest  = LongestWord;
+        bench_can_place(wordlist, seed, reps);
+        WordList cached(wordFile, ShortestWord, LongestWord);
+        cached.enable_cache(size_t(64) << 20);
+        bench_pattern(wordlist, cached, seed, reps);
+        bench_rollback(wordlist, seed, reps);
+        bench_fill(wordlist, cached, seed, reps);
+        bench_generate(LettersGenerator(wordlist), "letters", params, seed, reps);
+        params.max_tries = 10000;
+        bench_generate(LettersGenerator(wordlist), "letters/tries", params, seed, reps);
+        params.max_tries = 0;
+        params.reseed = true;
+        bench_generate(LettersGenerator(wordlist), "letters/reseed", params, seed, reps);
+        params.reseed = false;
+        bench_generate(LettersGenerator(wordlist), "letters", params, seed, reps, LargeSizes);
+        bench_generate(TiledGenerator(wordlist), "tiled", params, seed, reps, LargeSizes);
+        bench_do_weight(wordlist, seed, reps);
+        bench_generate(WeightGenerator(wordlist), "weight", params, seed, reps);
+
+        string dump;
+        if (stats == "json")            Instrumentation::json(dump);
+        else if (stats == "prometheus") Instrumentation::prometheus(dump);
+        cerr << dump << (stats == "json" ? "\n" : "");
+    }
+    catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,255 @@
+/*
+Binary dictionary format, written by 'index_adder -b' and mapped by the
+generators, so that loading a dictionary costs one mmap() instead of parsing
+every word.
+
+Layout (all integers are uint32 in host byte order):
+
+ Header  : magic "CWGD", version, bucket count, word count, checksum
+ Buckets : one entry per word length { length, first id, count, offset }
+ Words   : the words of each bucket back to back, uppercase, without any
+           separator. Every word in a bucket has the bucket's length, so
+           word i of a bucket starts at offset + i * length.
+ Weights : version 2 only: a float32 weight per word id, 4-byte aligned
+           right behind the words (see word_list.h)
+
+Word ids are global and sorted by length, so all words within a length range
+have contiguous ids. The checksum is FNV-1a over everything behind the header.
+
+Loading checks the header and the bucket table, so no word id, weight or
+word offset can point outside the file. The checksum reads the whole file,
+so it's only checked on request (MappedDictionary's 'verify'): index_adder
+checks the file it wrote and the server the dictionary it keeps, while the
+command line generators start without reading more than they use.
+*/
+
+#ifndef BINARY_DICTIONARY_H
+#define BINARY_DICTIONARY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char     DictMagic[4]      = { 'C', 'W', 'G', 'D' };
+constexpr uint32_t DictVersion       = 1;
+constexpr uint32_t DictWeightedVersion = 2;
+constexpr int      DictMaxWordLength = 32;
+
+struct DictHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t bucket_count;
+    uint32_t word_count;
+    uint32_t checksum;
+};
+
+struct DictBucket {
+    uint32_t length;  // length of each word within the bucket
+    uint32_t first;   // id of the bucket's first word
+    uint32_t count;   // number of words
+    uint32_t offset;  // file offset of the first word
+};
+
+// FNV-1a; 'hash' continues the checksum of preceding data.
+inline uint32_t dict_checksum(const char* data, size_t size, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* True if 's' is a word weight as given in a text dictionary's second
+ * column: a finite, non-negative number.
+ */
+inline bool dict_parse_weight(std::string_view s, float& weight) {
+    std::string token(s);
+    char* end = nullptr;
+    double value = std::strtod(token.c_str(), &end);
+    if (token.empty() || end != token.c_str() + token.size() || !std::isfinite(value) || value < 0)
+        return false;
+    weight = float(value);
+    return true;
+}
+
+/* Writes the words to 'out' in the binary format.
+ * buckets[i] holds the (already uppercased) words of length i+1, back to back
+ * (see word_ingester.h). They are written as they are, without another copy.
+ * weights[i], if given, holds the weights of the words of buckets[i].
+ */
+inline void write_binary_dictionary(std::ostream& out, const std::vector<std::string>& buckets,
+                                    const std::vector<std::vector<float>>& weights = {}) {
+    std::vector<DictBucket> table;
+    uint64_t first = 0;
+    uint64_t offset = sizeof(DictHeader);
+    for (size_t i = 0; i < buckets.size(); ++i)
+        if (!buckets[i].empty()) offset += sizeof(DictBucket);
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (buckets[i].empty()) continue;
+        const uint32_t length = i + 1;
+        DictBucket b{ length, uint32_t(first), uint32_t(buckets[i].size() / length),
+                      uint32_t(offset) };
+        table.push_back(b);
+        first  += b.count;
+        offset += buckets[i].size();
+    }
+    const char padding[4] = {};
+    const size_t pad = weights.empty() ? 0 : (4 - offset % 4) % 4;
+    if (offset + pad + (weights.empty() ? 0 : first * sizeof(float)) > UINT32_MAX)
+        throw std::runtime_error("Too many words for a binary dictionary");
+
+    const char* table_data = reinterpret_cast<const char*>(table.data());
+    const size_t table_size = table.size() * sizeof(DictBucket);
+    uint32_t checksum = dict_checksum(table_data, table_size);
+    for (const auto& bucket : buckets) checksum = dict_checksum(bucket.data(), bucket.size(), checksum);
+    checksum = dict_checksum(padding, pad, checksum);
+    for (const auto& w : weights)
+        checksum = dict_checksum(reinterpret_cast<const char*>(w.data()), w.size() * sizeof(float),
+                                 checksum);
+
+    DictHeader header;
+    std::memcpy(header.magic, DictMagic, sizeof(DictMagic));
+    header.version      = weights.empty() ? DictVersion : DictWeightedVersion;
+    header.bucket_count = table.size();
+    header.word_count   = first;
+    header.checksum     = checksum;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(table_data, table_size);
+    for (const auto& bucket : buckets) out.write(bucket.data(), bucket.size());
+    out.write(padding, pad);
+    for (const auto& w : weights)
+        out.write(reinterpret_cast<const char*>(w.data()), w.size() * sizeof(float));
+}
+
+/* A read-only view of a binary dictionary file.
+ * The file is mapped into memory; words are handed out as string_views
+ * pointing straight into the mapping, nothing is copied.
+ */
+class MappedDictionary {
+public:
+    // With 'verify' the checksum is checked as well, see above.
+    explicit MappedDictionary(const std::string& filename, bool verify = false) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(DictHeader)) {
+            ::close(fd);
+            throw std::runtime_error(filename + " is no binary dictionary");
+        }
+        m_size = st.st_size;
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) throw std::runtime_error("Cannot map " + filename);
+        m_data = static_cast<const char*>(data);
+        try {
+            validate(filename);
+            if (verify && !this->verify())
+                throw std::runtime_error(filename + " is corrupt (bad checksum)");
+        }
+        catch (...) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+            throw;
+        }
+    }
+    MappedDictionary(const MappedDictionary&) = delete;
+    MappedDictionary& operator=(const MappedDictionary&) = delete;
+    ~MappedDictionary() {
+        if (m_data) ::munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    // True if the file starts with the binary dictionary's magic.
+    static bool is_binary(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        char magic[sizeof(DictMagic)] = {};
+        in.read(magic, sizeof(magic));
+        return in && std::memcmp(magic, DictMagic, sizeof(magic)) == 0;
+    }
+
+    uint32_t size() const { return header().word_count; }
+
+    // The weight of each word id, or nullptr if the dictionary has none.
+    const float* weights() const { return m_weights; }
+
+    std::string_view word(uint32_t id) const {
+        const DictBucket* b = std::upper_bound(m_buckets, m_buckets + bucket_count(), id,
+            [](uint32_t i, const DictBucket& bucket) { return i < bucket.first; }) - 1;
+        return { m_data + b->offset + (id - b->first) * b->length, b->length };
+    }
+
+    // Returns the ids [first, last) of all words with shortest <= length <= longest.
+    std::pair<uint32_t, uint32_t> range(int shortest, int longest) const {
+        uint32_t first = size(), last = 0;
+        for (uint32_t i = 0; i < bucket_count(); ++i) {
+            const auto& b = m_buckets[i];
+            if (int(b.length) < shortest || int(b.length) > longest) continue;
+            first = std::min(first, b.first);
+            last  = std::max(last, b.first + b.count);
+        }
+        return first < last ? std::make_pair(first, last) : std::make_pair(0u, 0u);
+    }
+
+    // Recomputes the checksum; this touches the whole file.
+    bool verify() const {
+        return dict_checksum(m_data + sizeof(DictHeader), m_size - sizeof(DictHeader))
+               == header().checksum;
+    }
+
+private:
+    const DictHeader& header() const
+        { return *reinterpret_cast<const DictHeader*>(m_data); }
+    uint32_t bucket_count() const { return header().bucket_count; }
+
+    void validate(const std::string& filename) {
+        const auto& h = header();
+        if (std::memcmp(h.magic, DictMagic, sizeof(DictMagic)) != 0)
+            throw std::runtime_error(filename + " is no binary dictionary");
+        if (h.version != DictVersion && h.version != DictWeightedVersion)
+            throw std::runtime_error(filename + " has unsupported version "
+                                     + std::to_string(h.version));
+        if (h.bucket_count == 0 || h.bucket_count > DictMaxWordLength
+         || sizeof(DictHeader) + h.bucket_count * sizeof(DictBucket) > m_size)
+            throw std::runtime_error(filename + " has a corrupt header");
+        m_buckets = reinterpret_cast<const DictBucket*>(m_data + sizeof(DictHeader));
+        // buckets by ascending length, ids contiguous from 0, words behind the table
+        const uint64_t words_start = sizeof(DictHeader) + h.bucket_count * sizeof(DictBucket);
+        uint64_t words_end = 0, ids = 0;
+        for (uint32_t i = 0; i < h.bucket_count; ++i) {
+            const auto& b = m_buckets[i];
+            words_end = std::max(words_end, uint64_t(b.offset) + uint64_t(b.count) * b.length);
+            if (b.length == 0 || b.length > uint32_t(DictMaxWordLength)
+             || (i > 0 && b.length <= m_buckets[i - 1].length)
+             || b.first != ids || b.offset < words_start || words_end > m_size)
+                throw std::runtime_error(filename + " has a corrupt bucket table");
+            ids += b.count;
+        }
+        if (ids != h.word_count)
+            throw std::runtime_error(filename + " has a corrupt bucket table");
+        if (h.version == DictWeightedVersion) {
+            const uint64_t start = (words_end + 3) / 4 * 4;
+            if (start + uint64_t(h.word_count) * sizeof(float) > m_size)
+                throw std::runtime_error(filename + " has a corrupt weight section");
+            m_weights = reinterpret_cast<const float*>(m_data + start);
+        }
+    }
+
+    const char*       m_data = nullptr;
+    size_t            m_size = 0;
+    const DictBucket* m_buckets = nullptr;
+    const float*      m_weights = nullptr;
+};
+
+#endif // BINARY_DICTIONARY_H
@@ -0,0 +1,122 @@
+/*
+Kernels over bitsets stored as arrays of 64-bit blocks, as used by the
+pattern index (see pattern_index.h):
+
+ bitset_and      : dst = src[0] & src[1] & ... & src[n-1]
+ bitset_popcount : number of set bits
+ bitset_select   : position of the n'th set bit (n counts from 0)
+
+Together they draw a uniform random word out of an intersection without
+enumerating it: AND the keys, count the bits, pick n < count and select it.
+
+On x86 the AND and popcount kernels have an AVX2 version which is chosen at
+runtime if the CPU supports it; everywhere else the scalar version is used.
+*/
+
+#ifndef BITSET_KERNELS_H
+#define BITSET_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BITSET_KERNELS_AVX2 1
+#include <immintrin.h>
+#endif
+
+inline void bitset_and_scalar(uint64_t* dst, const uint64_t* const* src, size_t nsrc,
+                              size_t blocks) {
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t bits = src[0][i];
+        for (size_t k = 1; k < nsrc; ++k) bits &= src[k][i];
+        dst[i] = bits;
+    }
+}
+
+inline size_t bitset_popcount_scalar(const uint64_t* bits, size_t blocks) {
+    size_t count = 0;
+    for (size_t i = 0; i < blocks; ++i) count += __builtin_popcountll(bits[i]);
+    return count;
+}
+
+#ifdef BITSET_KERNELS_AVX2
+
+__attribute__((target("avx2")))
+inline void bitset_and_avx2(uint64_t* dst, const uint64_t* const* src, size_t nsrc,
+                            size_t blocks) {
+    size_t i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[0] + i));
+        for (size_t k = 1; k < nsrc; ++k)
+            bits = _mm256_and_si256(bits,
+                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[k] + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), bits);
+    }
+    const uint64_t* tail[64];
+    for (size_t k = 0; k < nsrc; ++k) tail[k] = src[k] + i;
+    bitset_and_scalar(dst + i, tail, nsrc, blocks - i);
+}
+
+// Nibble lookup popcount (Mula), summed per 64-bit lane with vpsadbw.
+__attribute__((target("avx2")))
+inline size_t bitset_popcount_avx2(const uint64_t* bits, size_t blocks) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits + i));
+        __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+        __m256i hi = _mm256_shuffle_epi8(lookup,
+                         _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        sum = _mm256_add_epi64(sum,
+                  _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+         + bitset_popcount_scalar(bits + i, blocks - i);
+}
+
+inline bool bitset_has_avx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif // BITSET_KERNELS_AVX2
+
+// nsrc must be within 1 .. 64.
+inline void bitset_and(uint64_t* dst, const uint64_t* const* src, size_t nsrc,
+                       size_t blocks) {
+#ifdef BITSET_KERNELS_AVX2
+    if (bitset_has_avx2()) return bitset_and_avx2(dst, src, nsrc, blocks);
+#endif
+    bitset_and_scalar(dst, src, nsrc, blocks);
+}
+
+inline size_t bitset_popcount(const uint64_t* bits, size_t blocks) {
+#ifdef BITSET_KERNELS_AVX2
+    if (bitset_has_avx2()) return bitset_popcount_avx2(bits, blocks);
+#endif
+    return bitset_popcount_scalar(bits, blocks);
+}
+
+/* Returns the position of the n'th set bit, or blocks * 64 if there are
+ * no more than n bits set.
+ */
+inline size_t bitset_select(const uint64_t* bits, size_t blocks, size_t n) {
+    for (size_t i = 0; i < blocks; ++i) {
+        size_t count = __builtin_popcountll(bits[i]);
+        if (n >= count) {
+            n -= count;
+            continue;
+        }
+        uint64_t block = bits[i];
+        for (; n > 0; --n) block &= block - 1;  // clear the n lowest set bits
+        return i * 64 + __builtin_ctzll(block);
+    }
+    return blocks * 64;
+}
+
+#endif // BITSET_KERNELS_H
@@ -0,0 +1,59 @@
+/*
+Fills a template of black squares with dictionary words, so that every letter
+is crossed by two words (American style). The slots and crossings of the
+template are solved as a constraint problem, see fill_engine.h.
+
+Usage: crossword_puzzle_generator_fill template [dictionary] [--seed S] [--nodes N]
+
+The template is a text file with one line per row: '#' is a black square, '.'
+an open cell, and a letter is kept as given. The dictionary is a text or
+binary word list (see index_adder -b). The search gives up after N tried
+words (default 1000000).
+*/
+
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "fill_engine.h"
+#include "word_list.h"
+using namespace std;
+
+const string WordFile = "wordlist.txt";
+
+int main(int argc, char **argv) {
+    string templateFile, wordFile = WordFile;
+    uint64_t seed = random_device{}();
+    long nodes = 1000000;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc)       seed = stoull(argv[++i]);
+        else if (arg == "--nodes" && i + 1 < argc) nodes = stol(argv[++i]);
+        else if (templateFile.empty())             templateFile = arg;
+        else                                       wordFile = arg;
+    }
+    if (templateFile.empty()) {
+        cerr << "Usage: " << argv[0]
+             << " template [dictionary] [--seed S] [--nodes N]\n";
+        return 1;
+    }
+
+    try {
+        const WordList wordlist(wordFile, 2, DictMaxWordLength);
+        FillEngine engine(wordlist, FillEngine::read_template(templateFile));
+        auto rng = puzzle_rng(seed, 0);
+        if (!engine.fill(rng, nodes)) {
+            cerr << "No fill found after " << engine.nodes() << " words\n";
+            return 2;
+        }
+        for (const auto& row : engine.grid()) {
+            for (char ch : row)
+                cout << (ch == FillEngine::Empty ? ' ' : ch) << ' ';
+            cout << '\n';
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,401 @@
+/*
+Generation server: loads the dictionary once and answers requests until its
+input ends, so a puzzle no longer costs a process start and a dictionary load.
+
+Requests are read from stdin, or with --socket from any number of connections
+to a Unix socket, one JSON object per line (see ndjson.h):
+
+  {"id": 7, "generator": "auto", "size": 15, "seed": 42, "count": 2}
+
+ id         echoed with every result (any JSON value)
+ generator  letters, weight, fill, tiled or auto (default), see generators.h
+ size       sets width and height; or width, height (default 30, at most
+            4096)
+ shortest, longest, max_tries, rounds, max_nodes, reseed, threads
+            see GeneratorParams
+ layout     the fill's template, an array of rows
+ seed       master seed, an integer from 0 to 2^64-1 (default random);
+            puzzle n is seeded from (seed, n)
+ count      number of puzzles (default 1, at most 100000)
+ budget_ms  makes each puzzle the densest of as many runs as all threads
+            finish within the budget (see portfolio.h); puzzle n takes the
+            runs (seed + n, run). With "auto" the runs take turns between
+            the strategies of portfolio_generators().
+ deadline_ms  without a budget: gives up on a puzzle which takes longer
+            (default 10000, at most 3600000), so no request holds a thread
+            for good, however large its grid, rounds or max_tries. Such a
+            puzzle is answered with "ok":false,"timeout":true, and with
+            the grid so far from the letters and weight approaches.
+
+The puzzles of all requests and connections are jobs on one pool, and every
+puzzle is written back as soon as it is done, so results may come out of
+order:
+
+  {"id":7,"n":0,"generator":"weight","ok":true,"width":15,"height":15,"ms":0.21,
+   "rows":["ABC.....",...]}
+
+A portfolio's result adds "run", the winning run, and "runs", the runs done;
+"partial":true if the winner is the grid a run had at the deadline.
+
+A request which can't be parsed or generated gets {"id":...,"ok":false,"error":"..."}.
+
+With {"id":...,"stats":"json"} or {"id":...,"stats":"prometheus"} the server
+answers with its counters so far instead of a puzzle, as "stats" object or
+as "prometheus" text (see instrumentation.h; empty unless the server was
+built with -DCWG_INSTRUMENT). With --cache the "stats" object is followed by
+"pattern_cache", the hits, misses, evictions, entries and bytes of the cache.
+
+--cache MB caches the matches of the slot patterns the fill's forward checking
+asks for, up to MB megabytes, for all requests (see pattern_cache.h).
+
+Usage: crossword_puzzle_server [dictionary] [--socket PATH] [--threads T] [--cache MB]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "generators.h"
+#include "instrumentation.h"
+#include "ndjson.h"
+#include "portfolio.h"
+#include "work_stealing_pool.h"
+using namespace std;
+
+const string WordFile = "wordlist.txt";
+const int MaxCount = 100000;  // puzzles per request
+const int MaxSide = 4096;     // grid width and height
+const int MaxThreads = 1024;  // tiled: regions at once
+const long MaxNodes = 1L << 40;
+const double MaxBudgetMs = 3600e3;    // and deadline
+const double DefaultDeadlineMs = 10e3;
+
+// The generators by name, all on the one resident dictionary.
+using Generators = map<string, unique_ptr<Generator>>;
+
+/* One client: requests are read from 'in', results written to 'out'.
+ * Results are written by the pool's workers, one whole line at a time.
+ */
+class Connection {
+public:
+    Connection(int in, int out) : m_in(in), m_out(out) { }
+
+    int in() const { return m_in; }
+
+    void send(const string& line) {
+        lock_guard<mutex> lock(m_mutex);
+        for (size_t done = 0; done < line.size(); ) {
+            ssize_t n = ::write(m_out, line.data() + done, line.size() - done);
+            if (n <= 0) return;  // client gone, drop the result
+            done += n;
+        }
+    }
+
+    void begin() { ++m_pending; }
+    void end() {
+        lock_guard<mutex> lock(m_mutex);  // drain() may return right after
+        if (--m_pending == 0) m_done.notify_all();
+    }
+    // Waits until all results of the connection are sent.
+    void drain() {
+        unique_lock<mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+    }
+
+private:
+    int m_in, m_out;
+    mutex m_mutex;
+    condition_variable m_done;
+    atomic<long> m_pending{0};
+};
+
+string error_line(const string& id, const string& what) {
+    string line = "{\"id\":" + id + ",\"ok\":false,\"error\":";
+    json_string(line, what);
+    return line + "}\n";
+}
+
+// The integer at 'key', or 'def' if there is none; it must be in [lo, hi].
+long integer(const JsonObject& req, const string& key, long def, long lo, long hi) {
+    const double x = req.number(key, def);
+    if (!isfinite(x) || x != floor(x) || x < lo || x > hi)
+        throw invalid_argument("Bad " + key + ", must be an integer from "
+                               + to_string(lo) + " to " + to_string(hi));
+    return long(x);
+}
+
+// The seed as written: an integer from 0 to 2^64-1, not rounded to a double.
+uint64_t read_seed(const JsonValue& v) {
+    if (v.type != JsonValue::Number) throw invalid_argument("seed must be a number");
+    const string& raw = v.raw;
+    const string max = to_string(numeric_limits<uint64_t>::max());
+    if (raw.empty() || raw.find_first_not_of("0123456789") != string::npos
+     || raw.size() > max.size() || (raw.size() == max.size() && raw > max))
+        throw invalid_argument("Bad seed, must be an integer from 0 to " + max);
+    return stoull(raw);
+}
+
+GeneratorParams read_params(const JsonObject& req) {
+    GeneratorParams params;
+    const int size = integer(req, "size", 0, 0, MaxSide);
+    params.width     = integer(req, "width",  size ? size : params.width,  1, MaxSide);
+    params.height    = integer(req, "height", size ? size : params.height, 1, MaxSide);
+    params.shortest  = integer(req, "shortest",  params.shortest,  1, MaxSide);
+    params.longest   = integer(req, "longest",   params.longest,   1, MaxSide);
+    params.max_tries = integer(req, "max_tries", params.max_tries, 0, INT_MAX);
+    params.rounds    = integer(req, "rounds",    params.rounds,    0, INT_MAX);
+    params.reseed    = req.boolean("reseed",   params.reseed);
+    params.threads   = integer(req, "threads",   params.threads,   0, MaxThreads);
+    params.max_nodes = integer(req, "max_nodes", params.max_nodes, 1, MaxNodes);
+    if (const JsonValue* layout = req.find("layout")) {
+        for (const auto& row : layout->items) {
+            if (row.type != JsonValue::String) throw invalid_argument("layout rows must be strings");
+            params.layout.push_back(row.text);
+        }
+        if (params.layout.empty()) throw invalid_argument("layout must be an array of rows");
+        if (params.layout.size() > size_t(MaxSide) || params.layout[0].size() > size_t(MaxSide))
+            throw invalid_argument("layout too large");
+        params.height = params.layout.size();
+        params.width  = params.layout[0].size();
+    }
+    return params;
+}
+
+// The result line of puzzle n; 'extra' are further fields, starting with ','.
+string result_line(const string& id, int n, const string& name, bool ok,
+                   const Puzzle& puzzle, double ms, const string& extra = "") {
+    string out = "{\"id\":" + id + ",\"n\":" + to_string(n)
+               + ",\"generator\":\"" + name + "\",\"ok\":"
+               + (ok ? "true" : "false")
+               + ",\"width\":" + to_string(puzzle.width())
+               + ",\"height\":" + to_string(puzzle.height())
+               + ",\"ms\":" + to_string(ms) + extra + ",\"rows\":[";
+    for (int r = 0; r < puzzle.height(); ++r) {
+        if (r) out += ',';
+        json_string(out, string_view(puzzle[r], puzzle.width()));
+    }
+    return out + "]}\n";
+}
+
+/* One puzzle of a request with a budget: a portfolio worked on by one job
+ * per pool thread. The last job to finish sends the result.
+ */
+struct PortfolioJob {
+    PortfolioJob(vector<const Generator*> generators, const GeneratorParams& params,
+                 uint64_t seed, chrono::milliseconds budget, unsigned workers)
+        : portfolio(move(generators), params, seed, budget), left(workers) { }
+
+    Portfolio portfolio;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    atomic<unsigned> left;
+    mutex error_mutex;
+    string error;
+};
+
+void submit_portfolio(Connection& conn, WorkStealingPool& pool, const Generators& generators,
+                      const string& name, const GeneratorParams& params, const string& id,
+                      uint64_t seed, int n, chrono::milliseconds budget) {
+    vector<const Generator*> runners;
+    for (const auto& runner : name == "auto" ? portfolio_generators(params) : vector<string>{ name })
+        runners.push_back(generators.at(runner).get());
+    auto job = make_shared<PortfolioJob>(move(runners), params, seed + n, budget, pool.size());
+    conn.begin();
+    for (unsigned i = 0; i < pool.size(); ++i)
+        pool.submit([&conn, job, id, name, n] {
+            try {
+                job->portfolio.work();
+            }
+            catch (const exception& e) {
+                lock_guard<mutex> lock(job->error_mutex);
+                job->error = e.what();
+            }
+            if (--job->left > 0) return;
+
+            if (!job->error.empty()) conn.send(error_line(id, job->error));
+            else {
+                PortfolioResult result;
+                bool ok = job->portfolio.result(result);
+                double ms = chrono::duration<double, milli>(
+                                chrono::steady_clock::now() - job->start).count();
+                conn.send(result_line(id, n, ok ? result.generator : name, ok, result.puzzle, ms,
+                                      ",\"run\":" + to_string(result.run)
+                                      + ",\"runs\":" + to_string(result.runs)
+                                      + (result.partial ? ",\"partial\":true" : "")));
+            }
+            conn.end();
+        });
+}
+
+// Parses one request line and submits its puzzles to the pool.
+void submit(const string& line, Connection& conn, WorkStealingPool& pool,
+            const Generators& generators, const WordList& wordlist) {
+    string id = "null";
+    try {
+        auto req = JsonObject::parse(line);
+        if (const JsonValue* v = req.find("id")) id = v->raw;
+        if (req.find("stats")) {
+            string format = req.string("stats", "json"), out = "{\"id\":" + id + ",\"ok\":true,";
+            if (format == "json") {
+                out += "\"stats\":";
+                Instrumentation::json(out);
+                if (const PatternCache* cache = wordlist.cache()) {
+                    auto s = cache->stats();
+                    out += ",\"pattern_cache\":{\"hits\":" + to_string(s.hits)
+                         + ",\"misses\":" + to_string(s.misses)
+                         + ",\"evictions\":" + to_string(s.evictions)
+                         + ",\"entries\":" + to_string(s.entries)
+                         + ",\"bytes\":" + to_string(s.bytes) + "}";
+                }
+            }
+            else if (format == "prometheus") {
+                string text;
+                Instrumentation::prometheus(text);
+                out += "\"prometheus\":";
+                json_string(out, text);
+            }
+            else throw invalid_argument("stats must be json or prometheus");
+            conn.send(out + "}\n");
+            return;
+        }
+        string name = req.string("generator", "auto");
+        auto it = generators.find(name);
+        if (it == generators.end()) throw invalid_argument("Unknown generator " + name);
+        const Generator& generator = *it->second;
+        auto params = make_shared<const GeneratorParams>(read_params(req));
+        uint64_t seed = random_device{}();
+        if (const JsonValue* v = req.find("seed")) seed = read_seed(*v);
+        const int count = integer(req, "count", 1, 1, MaxCount);
+        const double budget = req.number("budget_ms", 0);
+        if (!(budget >= 0 && budget <= MaxBudgetMs)) throw invalid_argument("Bad budget_ms");
+        if (budget > 0) {
+            for (int n = 0; n < count; ++n)
+                submit_portfolio(conn, pool, generators, name, *params, id, seed, n,
+                                 chrono::milliseconds(long(budget)));
+            return;
+        }
+        const double deadline_ms = req.number("deadline_ms", DefaultDeadlineMs);
+        if (!(deadline_ms >= 1 && deadline_ms <= MaxBudgetMs))
+            throw invalid_argument("Bad deadline_ms");
+        const chrono::milliseconds deadline{long(deadline_ms)};
+        if (name == "auto") name = best_generator(*params);
+
+        for (int n = 0; n < count; ++n) {
+            conn.begin();
+            pool.submit([&conn, &generator, params, id, name, seed, n, deadline] {
+                try {
+                    auto rng = puzzle_rng(seed, n);
+                    Puzzle puzzle;
+                    auto start = chrono::steady_clock::now();
+                    const Cancel cancel(start + deadline);
+                    GeneratorParams p = *params;
+                    p.cancel = &cancel;
+                    bool ok = generator.generate(p, rng, puzzle);
+                    double ms = chrono::duration<double, milli>(
+                                    chrono::steady_clock::now() - start).count();
+                    conn.send(result_line(id, n, name, ok, puzzle, ms,
+                                          !ok && cancel.stopped() ? ",\"timeout\":true" : ""));
+                }
+                catch (const exception& e) {
+                    conn.send(error_line(id, e.what()));
+                }
+                conn.end();
+            });
+        }
+    }
+    catch (const exception& e) {
+        conn.send(error_line(id, e.what()));
+    }
+}
+
+// Reads the connection's requests until its input ends, then drains it.
+void serve(Connection& conn, WorkStealingPool& pool, const Generators& generators,
+           const WordList& wordlist) {
+    string buffer;
+    char chunk[1 << 16];
+    for (ssize_t n; (n = ::read(conn.in(), chunk, sizeof(chunk))) > 0; ) {
+        buffer.append(chunk, n);
+        size_t start = 0;
+        for (size_t end; (end = buffer.find('\n', start)) != string::npos; start = end + 1)
+            if (end > start) submit(buffer.substr(start, end - start), conn, pool, generators,
+                                    wordlist);
+        buffer.erase(0, start);
+    }
+    if (!buffer.empty()) submit(buffer, conn, pool, generators, wordlist);
+    conn.drain();
+}
+
+int listen_on(const string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) throw runtime_error("Socket path too long");
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw runtime_error("Cannot create socket");
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+     || ::listen(fd, 64) < 0) {
+        ::close(fd);
+        throw runtime_error("Cannot listen on " + path);
+    }
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    string wordFile = WordFile, socketPath;
+    unsigned threads = thread::hardware_concurrency();
+    size_t cacheMB = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc)       socketPath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) threads = stoi(argv[++i]);
+        else if (arg == "--cache" && i + 1 < argc)   cacheMB = stoul(argv[++i]);
+        else                                         wordFile = arg;
+    }
+    signal(SIGPIPE, SIG_IGN);  // a client may go away before its results are sent
+
+    try {
+        WordList wordlist(wordFile, 1, DictMaxWordLength, true);  // checksum too, once per run
+        if (cacheMB) wordlist.enable_cache(cacheMB << 20);
+        Generators generators;
+        for (const auto& name : generator_names())
+            generators[name] = make_generator(name, wordlist);
+        WorkStealingPool pool(max(threads, 1u));
+
+        if (socketPath.empty()) {
+            Connection conn(STDIN_FILENO, STDOUT_FILENO);
+            serve(conn, pool, generators, wordlist);
+            return 0;
+        }
+        int listener = listen_on(socketPath);
+        for (;;) {
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0) continue;
+            thread([fd, &pool, &generators, &wordlist] {
+                Connection conn(fd, fd);
+                serve(conn, pool, generators, wordlist);
+                ::close(fd);
+            }).detach();
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,365 @@
+/*
+Dictionary as minimal acyclic automaton (DAWG), written by 'index_adder -d'
+and mapped by the generators like a binary dictionary (binary_dictionary.h).
+
+Words sharing a prefix share the path of the prefix, and words sharing a
+suffix share the path of the suffix. Every node knows the lengths of the
+words below it, so a walk for a pattern of length L takes only the edges
+which match the pattern's fixed letters and still lead to a word end exactly
+at L; a dead partial slot is found without listing a single word:
+
+ any(pattern)                  : true if some word matches; stops at the first
+ for_each_match(pattern, f)    : calls f(word) for every matching word
+ contains(word)
+
+WordList keeps the mapped automaton for any(), but still reads the words into
+its own pool and builds the pattern index (pattern_index.h) over them, since
+the generators draw by word id. So a DAWG doesn't save memory at run time;
+the index's bitsets take several times the words' size anyway.
+
+As in pattern_index.h, every character of a pattern which isn't a letter is
+a wildcard. Words are A-Z only.
+
+Layout (all integers in host byte order):
+
+ Header  : magic "CWGA", version, node count, edge count, word count, checksum
+ Lengths: per node a uint64, bit k set if a word ends k letters below the
+          node (bit 0: at the node). Node 0 is the root.
+ Firsts : per node the uint32 index of its first edge, and the edge count;
+          the edges of node n are [first[n], first[n+1])
+ Edges  : per edge a uint32, target node << 5 | letter (0 = 'A'), sorted by
+          letter within a node
+
+The checksum is FNV-1a (dict_checksum) over everything behind the header;
+like a binary dictionary's, it's only checked on request (Dawg's 'verify').
+The automaton is built by the incremental construction of Daciuk et al. for
+sorted input, so building needs memory for the result only, not for a trie.
+*/
+
+#ifndef DAWG_H
+#define DAWG_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary_dictionary.h"
+
+constexpr char     DawgMagic[4]   = { 'C', 'W', 'G', 'A' };
+constexpr uint32_t DawgVersion    = 1;
+constexpr int      DawgMaxLength  = 63;  // bits of a node's lengths, less bit 0
+
+struct DawgHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t word_count;
+    uint32_t checksum;
+};
+
+class Dawg {
+public:
+    /* Builds the automaton of the words, which must be uppercase A-Z; their
+     * order doesn't matter, duplicates are dropped. Throws
+     * std::invalid_argument for other words.
+     */
+    explicit Dawg(std::vector<std::string_view> words) {
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        build(words);
+    }
+
+    // Maps a file written by write(); with 'verify' its checksum is checked as well.
+    explicit Dawg(const std::string& filename, bool verify = false) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(DawgHeader)) {
+            ::close(fd);
+            throw std::runtime_error(filename + " is no DAWG dictionary");
+        }
+        m_size = st.st_size;
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) throw std::runtime_error("Cannot map " + filename);
+        m_data = static_cast<const char*>(data);
+        m_mapped = true;
+        try {
+            validate(filename);
+            if (verify && !this->verify())
+                throw std::runtime_error(filename + " is corrupt (bad checksum)");
+        }
+        catch (...) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+            throw;
+        }
+    }
+    Dawg(const Dawg&) = delete;
+    Dawg& operator=(const Dawg&) = delete;
+    ~Dawg() {
+        if (m_mapped) ::munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    // True if the file starts with the DAWG's magic.
+    static bool is_dawg(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        char magic[sizeof(DawgMagic)] = {};
+        in.read(magic, sizeof(magic));
+        return in && std::memcmp(magic, DawgMagic, sizeof(magic)) == 0;
+    }
+
+    void write(std::ostream& out) const { out.write(m_data, m_size); }
+
+    uint32_t size() const { return header().word_count; }
+    uint32_t nodes() const { return header().node_count; }
+    uint32_t edges() const { return header().edge_count; }
+    size_t bytes() const { return m_size; }
+
+    // True if some word matches 'pattern'.
+    bool any(std::string_view pattern) const {
+        bool found = false;
+        walk(pattern, [&](std::string_view) { found = true; return false; });
+        return found;
+    }
+
+    bool contains(std::string_view word) const {
+        for (char ch : word)
+            if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
+        return any(word);
+    }
+
+    // Calls f(string_view) for every word matching 'pattern', in alphabetic order.
+    template <class F>
+    size_t for_each_match(std::string_view pattern, F f) const {
+        size_t count = 0;
+        walk(pattern, [&](std::string_view word) { f(word); ++count; return true; });
+        return count;
+    }
+
+    // Recomputes the checksum; this touches the whole file.
+    bool verify() const {
+        return dict_checksum(m_data + sizeof(DawgHeader), m_size - sizeof(DawgHeader))
+               == header().checksum;
+    }
+
+private:
+    const DawgHeader& header() const { return *reinterpret_cast<const DawgHeader*>(m_data); }
+    const uint64_t* length_table() const
+        { return reinterpret_cast<const uint64_t*>(m_data + sizeof(DawgHeader)); }
+    const uint32_t* first_table() const
+        { return reinterpret_cast<const uint32_t*>(length_table() + nodes()); }
+    const uint32_t* edge_table() const { return first_table() + nodes() + 1; }
+
+    /* Walks the paths matching 'pattern', calling visit(word) at each match
+     * until it returns false.
+     */
+    template <class Visit>
+    void walk(std::string_view pattern, Visit visit) const {
+        if (pattern.empty() || pattern.size() > DawgMaxLength) return;
+        char word[DawgMaxLength];
+        struct Level {
+            uint32_t edge, last;  // next and end of the edges to try
+        };
+        Level stack[DawgMaxLength];
+        const uint64_t* lengths = length_table();
+        const uint32_t* first = first_table();
+        const uint32_t* edge = edge_table();
+        const size_t len = pattern.size();
+        if (!(lengths[0] >> len & 1)) return;
+
+        auto enter = [&](size_t depth, uint32_t n) {
+            // the edges of node n worth trying at this depth
+            Level l{ first[n], first[n + 1] };
+            unsigned char ch = pattern[depth];
+            if (std::isalpha(ch)) {
+                const uint32_t letter = std::toupper(ch) - 'A';
+                while (l.edge < l.last && (edge[l.edge] & 31) < letter) ++l.edge;
+                if (l.edge < l.last && (edge[l.edge] & 31) == letter) l.last = l.edge + 1;
+                else l.edge = l.last;
+            }
+            stack[depth] = l;
+        };
+        size_t depth = 0;
+        enter(0, 0);
+        for (;;) {
+            Level& l = stack[depth];
+            if (l.edge == l.last) {
+                if (depth == 0) return;
+                --depth;
+                continue;
+            }
+            const uint32_t e = edge[l.edge++];
+            const uint32_t target = e >> 5;
+            const size_t left = len - depth - 1;  // letters after this edge
+            if (!(lengths[target] >> left & 1)) continue;
+            word[depth] = char('A' + (e & 31));
+            if (left == 0) {
+                if (!visit(std::string_view(word, len))) return;
+                continue;
+            }
+            enter(++depth, target);
+        }
+    }
+
+    struct BuildNode {
+        bool final = false;
+        std::vector<std::pair<char, uint32_t>> edges;  // by letter
+    };
+
+    // Daciuk's incremental construction; the words are sorted and unique.
+    void build(const std::vector<std::string_view>& words) {
+        std::vector<BuildNode> nodes(1);                  // 0: root
+        std::vector<uint32_t> free_nodes;
+        std::unordered_map<std::string, uint32_t> registry;  // by signature
+        std::vector<uint32_t> path;                       // nodes along the previous word
+
+        auto signature = [&](uint32_t n) {
+            std::string key(1, nodes[n].final);
+            for (auto [letter, target] : nodes[n].edges) {
+                key += letter;
+                key.append(reinterpret_cast<const char*>(&target), sizeof(target));
+            }
+            return key;
+        };
+        // Registers or merges the nodes of the path below 'depth'.
+        auto minimize = [&](size_t depth) {
+            for (; path.size() > depth; path.pop_back()) {
+                const uint32_t child = path.back();
+                const uint32_t parent = path.size() > 1 ? path[path.size() - 2] : 0;
+                auto [it, inserted] = registry.emplace(signature(child), child);
+                if (inserted) continue;
+                nodes[parent].edges.back().second = it->second;
+                nodes[child] = BuildNode();
+                free_nodes.push_back(child);
+            }
+        };
+
+        std::string_view previous;
+        for (std::string_view word : words) {
+            if (word.size() > size_t(DawgMaxLength))
+                throw std::invalid_argument("Word too long for a DAWG: " + std::string(word));
+            for (char ch : word)
+                if (ch < 'A' || ch > 'Z')
+                    throw std::invalid_argument("Not an uppercase word: " + std::string(word));
+            size_t common = 0;
+            while (common < word.size() && common < previous.size()
+                && word[common] == previous[common]) ++common;
+            minimize(common);
+            uint32_t n = common ? path[common - 1] : 0;
+            for (size_t i = common; i < word.size(); ++i) {
+                uint32_t child;
+                if (free_nodes.empty()) {
+                    child = nodes.size();
+                    nodes.emplace_back();
+                }
+                else {
+                    child = free_nodes.back();
+                    free_nodes.pop_back();
+                }
+                nodes[n].edges.emplace_back(word[i], child);
+                path.push_back(child);
+                n = child;
+            }
+            nodes[n].final = true;
+            previous = word;
+        }
+        minimize(0);
+        freeze(nodes, words.size());
+    }
+
+    // Lays the reachable nodes out in breadth-first order into m_owned.
+    void freeze(const std::vector<BuildNode>& nodes, size_t word_count) {
+        std::vector<uint32_t> index(nodes.size(), UINT32_MAX), order{ 0 };
+        index[0] = 0;
+        size_t edge_count = 0;
+        for (size_t i = 0; i < order.size(); ++i)
+            for (auto [letter, target] : nodes[order[i]].edges) {
+                ++edge_count;
+                if (index[target] != UINT32_MAX) continue;
+                index[target] = order.size();
+                order.push_back(target);
+            }
+        if (order.size() >= (1u << 27) || edge_count > UINT32_MAX)
+            throw std::runtime_error("Too many words for a DAWG");
+
+        std::vector<uint64_t> lengths(order.size(), 0);  // by new index, 0: not yet known
+        for (size_t i = 0; i < order.size(); ++i) word_lengths(nodes, index, i, order[i], lengths);
+
+        m_owned.assign(sizeof(DawgHeader) + order.size() * sizeof(uint64_t)
+                       + (order.size() + 1 + edge_count) * sizeof(uint32_t), '\0');
+        uint64_t* out_lengths = reinterpret_cast<uint64_t*>(&m_owned[sizeof(DawgHeader)]);
+        uint32_t* out_first = reinterpret_cast<uint32_t*>(out_lengths + order.size());
+        uint32_t* out_edges = out_first + order.size() + 1;
+        uint32_t e = 0;
+        for (size_t i = 0; i < order.size(); ++i) {
+            out_lengths[i] = lengths[i];
+            out_first[i] = e;
+            for (auto [letter, target] : nodes[order[i]].edges)
+                out_edges[e++] = index[target] << 5 | uint32_t(letter - 'A');
+        }
+        out_first[order.size()] = e;
+
+        DawgHeader header;
+        std::memcpy(header.magic, DawgMagic, sizeof(DawgMagic));
+        header.version    = DawgVersion;
+        header.node_count = order.size();
+        header.edge_count = edge_count;
+        header.word_count = word_count;
+        header.checksum   = dict_checksum(m_owned.data() + sizeof(DawgHeader),
+                                          m_owned.size() - sizeof(DawgHeader));
+        std::memcpy(&m_owned[0], &header, sizeof(header));
+        m_data = m_owned.data();
+        m_size = m_owned.size();
+    }
+
+    // The lengths bits of a node (new index i, old index n); depth is bounded by the word length.
+    static uint64_t word_lengths(const std::vector<BuildNode>& nodes,
+                                 const std::vector<uint32_t>& index, uint32_t i, uint32_t n,
+                                 std::vector<uint64_t>& lengths) {
+        if (lengths[i]) return lengths[i];  // every node is on the way to a word end
+        uint64_t bits = nodes[n].final;
+        for (auto [letter, target] : nodes[n].edges)
+            bits |= word_lengths(nodes, index, index[target], target, lengths) << 1;
+        return lengths[i] = bits;
+    }
+
+    void validate(const std::string& filename) const {
+        const auto& h = header();
+        if (std::memcmp(h.magic, DawgMagic, sizeof(DawgMagic)) != 0)
+            throw std::runtime_error(filename + " is no DAWG dictionary");
+        if (h.version != DawgVersion)
+            throw std::runtime_error(filename + " has unsupported version "
+                                     + std::to_string(h.version));
+        if (h.node_count == 0 || sizeof(DawgHeader) + uint64_t(h.node_count) * sizeof(uint64_t)
+                + (uint64_t(h.node_count) + 1 + h.edge_count) * sizeof(uint32_t) > m_size)
+            throw std::runtime_error(filename + " has a corrupt header");
+        const uint32_t* first = first_table();
+        const uint32_t* e = edge_table();
+        for (uint32_t i = 0; i < h.node_count; ++i)
+            if (first[i] > first[i + 1] || first[i + 1] > h.edge_count)
+                throw std::runtime_error(filename + " has a corrupt node table");
+        for (uint32_t i = 0; i < h.edge_count; ++i)
+            if ((e[i] >> 5) >= h.node_count || (e[i] & 31) >= 26)
+                throw std::runtime_error(filename + " has a corrupt edge table");
+    }
+
+    std::string m_owned;  // a built automaton
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+};
+
+#endif // DAWG_H
@@ -0,0 +1,347 @@
+/*
+Fill engine for dense, fully crossed grids (American style).
+
+A template is a grid of black squares ('#') and open cells ('.', or a letter
+which is kept as given). Every horizontal and vertical run of at least two
+open cells becomes a slot, and the crossings of the slots are worked out once
+per template (see slot_graph.h). Filling the template is then the constraint
+problem "every slot holds a dictionary word, crossing slots agree on their
+shared letter, no word is used twice", which is solved by backtracking:
+
+ - The unfilled slot with the fewest candidates is filled next (MRV), ties
+   going to the slot with the most unfilled crossings.
+ - After a slot is filled, the candidates of its unfilled crossing slots are
+   filtered by the shared letter (forward checking). If a slot is left
+   without candidates, the word is rejected at once. The candidates of a
+   slot are just the words matching its letters so far, so a crossing slot
+   with many candidates asks the dictionary instead of scanning them: a
+   dead slot is told by WordList::any() (on a DAWG, a walk which finds no
+   completion), the matches of a live one come from WordList::match(), so
+   with the pattern cache enabled (see pattern_cache.h) the patterns which
+   recur during the search and across fills are intersected once.
+ - If all words of a slot fail, the search jumps back to the latest filled
+   slot which took part in the failure, i.e. which removed candidates of the
+   failed slots (conflict-directed backjumping), and not just to the
+   previous one.
+
+The candidates of a slot are kept in one array: the 'live' entries from
+'base' on are the current candidates, filtered-out ones are swapped behind
+them, and the matches of a new query are appended as the new current range.
+Undoing a step only restores base, count and array size.
+
+The search doesn't allocate per node: the words tried and the conflict set
+of each search level are kept in buffers sized by fill(), and the words in
+use are marked in an array indexed by word id.
+*/
+
+#ifndef FILL_ENGINE_H
+#define FILL_ENGINE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "generator.h"
+#include "instrumentation.h"
+#include "slot_graph.h"
+#include "word_list.h"
+
+class FillEngine {
+public:
+    static constexpr char Black = SlotGraph::Black;
+    static constexpr char Empty = '.';
+
+    // The template rows must have equal length.
+    FillEngine(const WordList& words, std::vector<std::string> rows)
+        : m_words(words), m_grid(normalize(std::move(rows))), m_graph(m_grid),
+          m_slots(m_graph.size()) { }
+
+    // Reads a template, one row per line; empty lines are skipped.
+    static std::vector<std::string> read_template(const std::string& filename) {
+        std::ifstream in(filename);
+        if (!in) throw std::runtime_error("Cannot open " + filename);
+        std::vector<std::string> rows;
+        for (std::string line; std::getline(in, line); )
+            if (!line.empty()) rows.push_back(line);
+        if (rows.empty()) throw std::runtime_error(filename + " is empty");
+        return rows;
+    }
+
+    /* Fills the template. Gives up after max_nodes tried words, or once
+     * 'cancel' is stopped. Returns true if the whole template got filled.
+     */
+    template <class Rng>
+    bool fill(Rng& rng, long max_nodes = 1000000, const Cancel* cancel = nullptr) {
+        m_nodes = 0;
+        m_max_nodes = max_nodes;
+        m_cancel = cancel;
+        m_aborted = false;
+        m_used.assign(m_words.size(), -1);
+        m_trail.clear();
+        m_values.resize(m_slots.size() + 1);
+        m_conflicts.assign(m_slots.size() + 1, Levels(m_slots.size()));
+        for (int s = 0; s < int(m_slots.size()); ++s) {
+            auto& slot = m_slots[s];
+            slot.pattern = pattern(s);
+            if (!m_words.any(slot.pattern)) return false;
+            slot.domain.clear();
+            m_words.match(slot.pattern, slot.domain);
+            slot.base = 0;
+            slot.live = slot.domain.size();
+            slot.word = -1;
+            slot.pruned_by.clear();
+            if (slot.live == 0) return false;
+        }
+        CWG_TIME(Fill);
+        const bool solved = solve(0, rng, m_conflicts[0]);
+        CWG_COUNT_N(FillNodes, m_nodes);
+        if (!solved) return false;
+        for (int s = 0; s < int(m_slots.size()); ++s) {
+            auto word = m_words.word_view(m_slots[s].word);
+            for (int i = 0; i < m_graph.slot(s).len; ++i)
+                cell(s, i) = std::toupper(word[i]);
+        }
+        return true;
+    }
+
+    const std::vector<std::string>& grid() const { return m_grid; }
+    size_t slots() const { return m_slots.size(); }
+    long nodes() const { return m_nodes; }
+
+private:
+    /* Candidates from which on forward checking queries the dictionary
+     * instead of filtering; below, the scan is cheaper.
+     */
+    static constexpr size_t RequeryMin = 512;
+
+    // The search state of a slot; its place and crossings are in m_graph.
+    struct Slot {
+        std::vector<uint32_t> domain;  // candidates, [base, base + live) are current
+        size_t base = 0, live = 0;
+        long word = -1;                // assigned word id
+        std::vector<int> pruned_by;    // levels which filtered the domain
+        std::string pattern;           // the template's letters and those of
+                                       // the filled crossing slots
+    };
+    struct Prune {
+        int level, slot;
+        size_t base, live, size;       // of the domain before the step
+    };
+
+    // A set of search levels, used as conflict set.
+    class Levels {
+    public:
+        explicit Levels(size_t n) : m_bits((n + 63) / 64 + 1, 0) {}
+        void set(int i) { m_bits[i / 64] |= uint64_t(1) << (i % 64); }
+        void reset(int i) { m_bits[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+        bool test(int i) const { return m_bits[i / 64] >> (i % 64) & 1; }
+        void clear() { std::fill(m_bits.begin(), m_bits.end(), 0); }
+        Levels& operator|=(const Levels& o) {
+            for (size_t i = 0; i < m_bits.size(); ++i) m_bits[i] |= o.m_bits[i];
+            return *this;
+        }
+    private:
+        std::vector<uint64_t> m_bits;
+    };
+
+    static std::vector<std::string> normalize(std::vector<std::string> rows) {
+        for (const auto& row : rows)
+            if (row.size() != rows[0].size())
+                throw std::invalid_argument("Template rows differ in length");
+        for (auto& row : rows)
+            for (auto& ch : row)
+                ch = std::isalpha(static_cast<unsigned char>(ch)) ? std::toupper(ch)
+                   : ch == Black ? Black : Empty;
+        return rows;
+    }
+
+    char& cell(int s, int i) {
+        const auto& slot = m_graph.slot(s);
+        return slot.horz ? m_grid[slot.row][slot.col + i] : m_grid[slot.row + i][slot.col];
+    }
+
+    std::string pattern(int s) {
+        std::string p;
+        for (int i = 0; i < m_graph.slot(s).len; ++i) p += cell(s, i);
+        return p;
+    }
+
+    char letter(uint32_t id, int pos) const
+        { return std::toupper(m_words.word_view(id)[pos]); }
+
+    // The unfilled slot with the fewest candidates, or -1 if all are filled.
+    int select_slot() const {
+        int best = -1;
+        size_t best_live = 0, best_degree = 0;
+        for (int s = 0; s < int(m_slots.size()); ++s) {
+            const auto& slot = m_slots[s];
+            if (slot.word >= 0) continue;
+            size_t degree = 0;
+            for (const auto& c : m_graph.crossings(s))
+                if (m_slots[c.slot].word < 0) ++degree;
+            if (best < 0 || slot.live < best_live
+             || (slot.live == best_live && degree > best_degree)) {
+                best = s;
+                best_live = slot.live;
+                best_degree = degree;
+            }
+        }
+        return best;
+    }
+
+    /* Filters the candidates of the unfilled slots crossing s.
+     * Returns a slot left without candidates, or -1.
+     */
+    int forward_check(int s, int level) {
+        const auto& slot = m_slots[s];
+        for (const auto& c : m_graph.crossings(s)) {
+            auto& other = m_slots[c.slot];
+            const char ch = letter(slot.word, c.pos);
+            other.pattern[c.other_pos] = ch;
+            if (other.word >= 0) continue;
+            const size_t size = other.domain.size();
+            size_t live = other.live;
+            bool queried = false;
+            if (live >= RequeryMin) {
+                queried = m_words.any(other.pattern);
+                live = queried ? m_words.match(other.pattern, other.domain) : 0;
+            }
+            else {
+                uint32_t* domain = other.domain.data() + other.base;
+                for (size_t i = 0; i < live; )
+                    if (letter(domain[i], c.other_pos) == ch) ++i;
+                    else std::swap(domain[i], domain[--live]);
+            }
+            if (live == other.live) {
+                other.domain.resize(size);
+                continue;
+            }
+            m_trail.push_back(Prune{ level, c.slot, other.base, other.live, size });
+            other.pruned_by.push_back(level);
+            if (queried) other.base = size;
+            other.live = live;
+            if (live == 0) return c.slot;
+        }
+        return -1;
+    }
+
+    // Takes the letters of slot s back out of the patterns of its crossing slots.
+    void clear_letters(int s) {
+        for (const auto& c : m_graph.crossings(s))
+            m_slots[c.slot].pattern[c.other_pos] = cell(c.slot, c.other_pos);
+    }
+
+    void undo(int level) {
+        for (; !m_trail.empty() && m_trail.back().level == level; m_trail.pop_back()) {
+            const Prune& p = m_trail.back();
+            auto& slot = m_slots[p.slot];
+            slot.base = p.base;
+            slot.live = p.live;
+            slot.domain.resize(p.size);
+            slot.pruned_by.pop_back();
+        }
+    }
+
+    /* Fills the remaining slots, starting at the given search level.
+     * On failure 'conflict' holds the levels the failure depends on.
+     */
+    template <class Rng>
+    bool solve(int level, Rng& rng, Levels& conflict) {
+        const int s = select_slot();
+        if (s < 0) return true;
+        auto& slot = m_slots[s];
+        auto& values = m_values[level];
+        values.assign(slot.domain.begin() + slot.base,
+                      slot.domain.begin() + slot.base + slot.live);
+        random_order(values.begin(), values.end(), rng);
+
+        for (uint32_t id : values) {
+            if (++m_nodes > m_max_nodes) m_aborted = true;
+            if (m_cancel && m_nodes % 1024 == 0 && m_cancel->stopped()) m_aborted = true;
+            if (m_aborted) break;
+            if (m_used[id] >= 0) {
+                conflict.set(m_used[id]);
+                continue;
+            }
+            slot.word = id;
+            m_used[id] = level;
+
+            int wiped = forward_check(s, level);
+            if (wiped >= 0) {
+                CWG_COUNT(FillWipeouts);
+                for (int l : m_slots[wiped].pruned_by)
+                    if (l != level) conflict.set(l);
+            }
+            else {
+                Levels& sub = m_conflicts[level + 1];
+                sub.clear();
+                if (solve(level + 1, rng, sub)) return true;
+                if (!m_aborted && !sub.test(level)) {
+                    // this word isn't part of the failure: jump further back
+                    undo(level);
+                    clear_letters(s);
+                    m_used[id] = -1;
+                    slot.word = -1;
+                    conflict = sub;
+                    return false;
+                }
+                sub.reset(level);
+                conflict |= sub;
+            }
+            undo(level);
+            clear_letters(s);
+            m_used[id] = -1;
+            slot.word = -1;
+        }
+        for (int l : slot.pruned_by) conflict.set(l);
+        return false;
+    }
+
+    const WordList& m_words;
+    std::vector<std::string> m_grid;
+    const SlotGraph m_graph;
+    std::vector<Slot> m_slots;
+    std::vector<Prune> m_trail;
+    std::vector<int> m_used;                   // per word id: level which used it, or -1
+    std::vector<std::vector<uint32_t>> m_values;  // per level: the words to try
+    std::vector<Levels> m_conflicts;           // per level: conflict set of its solve()
+    long m_nodes = 0, m_max_nodes = 0;
+    const Cancel* m_cancel = nullptr;
+    bool m_aborted = false;
+};
+
+/* The fill as Generator. The template is GeneratorParams::layout; without one
+ * the whole width x height grid is open.
+ */
+class FillGenerator : public Generator {
+public:
+    explicit FillGenerator(const WordList& wordlist) : m_words(wordlist) { }
+
+    const char* name() const override { return "fill"; }
+
+    bool generate(const GeneratorParams& params, GeneratorRng& rng,
+                  Puzzle& puzzle) const override {
+        auto layout = params.layout;
+        if (layout.empty()) {
+            if (params.width < 1 || params.height < 1)
+                throw std::invalid_argument("Bad grid size");
+            layout.assign(params.height, std::string(params.width, FillEngine::Empty));
+        }
+        FillEngine engine(m_words, std::move(layout));
+        if (!engine.fill(rng, params.max_nodes, params.cancel)) return false;
+        const auto& grid = engine.grid();
+        puzzle = Puzzle(grid[0].size(), grid.size());
+        for (size_t r = 0; r < grid.size(); ++r)
+            std::copy(grid[r].begin(), grid[r].end(), puzzle[r]);
+        return true;
+    }
+
+private:
+    const WordList& m_words;
+};
+
+#endif // FILL_ENGINE_H
@@ -0,0 +1,137 @@
+/*
+A grid stored in one contiguous buffer, for the weight approach (Cwg).
+
+Besides the row-major cells the grid keeps a column-major copy, so that a
+vertical word runs along a contiguous line as well. Both copies are padded
+with empty cells, which lets the search kernel read whole vector registers
+past the end of a line.
+
+best() is the whole-grid search of Cwg::highestWeight: for one line it scores
+32 start positions at once. For every letter of the word the 32 grid bytes
+under it are compared with the letter (a crossing, which adds 1 to the
+weight) and with the empty cell; an empty cell also needs empty cells on both
+neighbor lines. The cells before and after the word need to be empty.
+The best position is the one with the highest weight, ties going to the
+smallest row, then the smallest column, like the cell by cell scan.
+*/
+
+#ifndef FLAT_GRID_H
+#define FLAT_GRID_H
+
+#include <string_view>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FLAT_GRID_AVX2 1
+#include <immintrin.h>
+#endif
+
+class FlatGrid {
+public:
+    static constexpr char Empty = '.';
+    static constexpr int  Padding = 64;  // bytes behind each copy
+
+    struct Best {
+        int x, y;  // column, row
+        int wt;    // -1 if no position fits
+    };
+
+    FlatGrid(int width, int height)
+        : m_width(width), m_height(height),
+          m_rows(width * height + Padding, Empty),
+          m_cols(width * height + Padding, Empty) {}
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    const char* operator[](int row) const { return &m_rows[row * m_width]; }
+
+    void set(int row, int col, char ch) {
+        m_rows[row * m_width + col] = ch;
+        m_cols[col * m_height + row] = ch;
+    }
+
+    // True if best() is available on this CPU.
+    static bool simd() {
+#ifdef FLAT_GRID_AVX2
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+#else
+        return false;
+#endif
+    }
+
+    /* Returns the best position for the word with its first letter within
+     * rows [row0, row1) and columns [col0, col1). The caller makes sure that
+     * neither the word nor the cells around it leave the grid.
+     * Only available if simd() is true.
+     */
+    Best best(std::string_view word, bool horz, int row0, int row1, int col0, int col1) const {
+        Best best{ col0, row0, -1 };
+#ifdef FLAT_GRID_AVX2
+        if (horz)
+            for (int row = row0; row < row1; ++row)
+                search(m_rows.data(), m_width, row, col0, col1, word, true, best);
+        else
+            for (int col = col0; col < col1; ++col)
+                search(m_cols.data(), m_height, col, row0, row1, word, false, best);
+#endif
+        return best;
+    }
+
+private:
+#ifdef FLAT_GRID_AVX2
+    __attribute__((target("avx2")))
+    static __m256i load(const char* p)
+        { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+    /* Scores the start positions [pos0, pos1) along the given line of a copy
+     * with the given stride. Positions are columns for rows and rows for columns.
+     */
+    __attribute__((target("avx2")))
+    static void search(const char* cells, int stride, int line, int pos0, int pos1,
+                       std::string_view word, bool horz, Best& best) {
+        const __m256i empty = _mm256_set1_epi8(Empty);
+        const int len = word.size();
+        for (int start = pos0; start < pos1; start += 32) {
+            const char* cur  = cells + line * stride + start;
+            const char* prev = cur - stride;
+            const char* next = cur + stride;
+
+            __m256i valid = _mm256_and_si256(_mm256_cmpeq_epi8(load(cur - 1), empty),
+                                             _mm256_cmpeq_epi8(load(cur + len), empty));
+            __m256i count = _mm256_setzero_si256();
+            for (int p = 0; p < len && !_mm256_testz_si256(valid, valid); ++p) {
+                __m256i cell  = load(cur + p);
+                __m256i match = _mm256_cmpeq_epi8(cell, _mm256_set1_epi8(word[p]));
+                __m256i free  = _mm256_and_si256(_mm256_cmpeq_epi8(cell, empty),
+                                _mm256_and_si256(_mm256_cmpeq_epi8(load(prev + p), empty),
+                                                 _mm256_cmpeq_epi8(load(next + p), empty)));
+                valid = _mm256_and_si256(valid, _mm256_or_si256(match, free));
+                count = _mm256_sub_epi8(count, match);  // a match is -1
+            }
+            unsigned mask = _mm256_movemask_epi8(valid);
+            if (pos1 - start < 32) mask &= (1u << (pos1 - start)) - 1;
+            if (!mask) continue;
+
+            alignas(32) signed char counts[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(counts), count);
+            for (; mask; mask &= mask - 1) {
+                int lane = __builtin_ctz(mask);
+                int x = horz ? start + lane : line;
+                int y = horz ? line : start + lane;
+                int wt = counts[lane];
+                if (wt > best.wt
+                 || (wt == best.wt && (y < best.y || (y == best.y && x < best.x))))
+                    best = Best{ x, y, wt };
+            }
+        }
+    }
+#endif
+
+    int m_width, m_height;
+    std::vector<char> m_rows;  // row-major cells
+    std::vector<char> m_cols;  // column-major cells
+};
+
+#endif // FLAT_GRID_H
@@ -0,0 +1,155 @@
+/*
+The common interface of the generators.
+
+A Generator is one strategy to lay out a puzzle: the letters table approach
+(letters_generator.h), the weight approach (weight_generator.h) or the
+template fill (fill_engine.h). It is built on a shared WordList and keeps no
+state between calls, so one instance can serve any number of threads; all
+randomness comes from the caller's engine, all settings from GeneratorParams.
+See generators.h for creating one by name.
+
+The result is a Puzzle: a width x height grid of letters, empty cells ('.')
+and black squares ('#').
+
+A generation can be cut short by a Cancel (GeneratorParams::cancel), see
+portfolio.h. It returns false then; the letters table and weight approaches
+leave their grid so far in the puzzle, which is a valid puzzle too (every run
+of letters is a word), the others leave the puzzle as it was.
+*/
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "word_list.h"
+
+using GeneratorRng = CounterRng;
+
+// An engine for the n'th puzzle of a run with the given master seed,
+// so a puzzle doesn't depend on the thread which generates it.
+inline GeneratorRng puzzle_rng(uint64_t seed, uint64_t n) { return GeneratorRng(seed, n); }
+
+/* Stops generations early: once stop() was called or the deadline has passed,
+ * stopped() is true and the generators give up and return false. They check
+ * it between words, so one Cancel may be shared by any number of threads.
+ */
+class Cancel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Cancel(Clock::time_point deadline = Clock::time_point::max())
+        : m_deadline(deadline) { }
+
+    void stop() { m_stopped.store(true, std::memory_order_relaxed); }
+    bool stopped() const {
+        if (m_stopped.load(std::memory_order_relaxed)) return true;
+        if (Clock::now() < m_deadline) return false;
+        m_stopped.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    Clock::time_point m_deadline;
+    mutable std::atomic<bool> m_stopped{false};
+};
+
+/* Settings of a generation. Each strategy uses the ones which apply to it;
+ * 0 selects the strategy's default.
+ */
+struct GeneratorParams {
+    int width = 30, height = 30;
+    int shortest = 3, longest = 8;       // word lengths
+    int max_tries = 0;                   // letters: random slots tried per word,
+                                         //          0: every slot of every letter
+    bool prune = true;                   // letters: drop letters which can't be
+                                         //          crossed any more at once
+    bool reseed = false;                 // letters: place new seed words on empty
+                                         //          runs; the puzzle falls apart in
+                                         //          islands, see letters_generator.h
+    int threads = 0;                     // tiled: regions generated at once,
+                                         //        0: all cores; unused on a
+                                         //        pool worker, which shares its pool
+    int rounds = 0;                      // weight: words tried per direction,
+                                         //         0: width * height / 9
+    long max_nodes = 1000000;            // fill: words tried before giving up
+    std::vector<std::string> layout;     // fill: template rows, see fill_engine.h
+    const Cancel* cancel = nullptr;      // all: gives up once this is stopped
+    const std::atomic<int>* beat = nullptr;  // letters, weight: gives up once the
+                                         //   puzzle can't get more letters than this
+
+    bool cancelled() const { return cancel && cancel->stopped(); }
+    // True if a puzzle of at most 'most' letters won't beat 'beat'.
+    bool beaten(int most) const { return beat && most <= beat->load(std::memory_order_relaxed); }
+};
+
+class Puzzle {
+public:
+    static constexpr char Empty = '.';
+    static constexpr char Black = '#';
+
+    Puzzle(int width = 0, int height = 0)
+        : m_width(width), m_height(height), m_cells(width * height, Empty) {}
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    const char* operator[](int row) const { return &m_cells[row * m_width]; }
+    char* operator[](int row) { return &m_cells[row * m_width]; }
+
+    // Number of letter cells.
+    int letters() const {
+        int count = 0;
+        for (char ch : m_cells) count += ch != Empty && ch != Black;
+        return count;
+    }
+    double density() const
+        { return m_cells.empty() ? 0 : double(letters()) / m_cells.size(); }
+
+    // One line per row, uppercase letters separated by blanks; empty cells are blank.
+    void print(std::ostream& out) const {
+        std::string text;  // written at once
+        append_text(text);
+        out.write(text.data(), text.size());
+    }
+    // Appends the print() layout to 'out'.
+    void append_text(std::string& out) const {
+        out.reserve(out.size() + size_t(2 * m_width + 1) * m_height);
+        for (int r = 0; r < m_height; ++r) {
+            for (int c = 0; c < m_width; ++c) {
+                char ch = std::toupper((*this)[r][c]);
+                out += ch == Empty ? ' ' : ch;
+                out += ' ';
+            }
+            out += '\n';
+        }
+    }
+
+private:
+    int m_width, m_height;
+    std::string m_cells;  // row-major
+};
+
+class Generator {
+public:
+    virtual ~Generator() = default;
+
+    virtual const char* name() const = 0;
+
+    /* Generates a puzzle into 'puzzle'. Returns false if none was found
+     * (only the fill can fail) or the generation was cancelled; throws std::invalid_argument for parameters
+     * the strategy can't work with.
+     */
+    virtual bool generate(const GeneratorParams& params, GeneratorRng& rng,
+                          Puzzle& puzzle) const = 0;
+};
+
+#endif // GENERATOR_H
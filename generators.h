@@ -0,0 +1,148 @@
+/*
+All generators by name, and batch generation on a thread pool.
+
+ letters : the letters table approach (letters_generator.h)
+ weight  : the weight approach (weight_generator.h)
+ fill    : template fill (fill_engine.h)
+ tiled   : large boards by regions in parallel (tiled_generator.h)
+ auto    : picks one of the above per request, see best_generator()
+
+An embedding program loads one WordList, creates the generators it needs and
+keeps them; each generate() call is independent of the others.
+*/
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fill_engine.h"
+#include "generator.h"
+#include "letters_generator.h"
+#include "tiled_generator.h"
+#include "weight_generator.h"
+#include "word_list.h"
+#include "work_stealing_pool.h"
+
+inline const std::vector<std::string>& generator_names() {
+    static const std::vector<std::string> names{ "letters", "weight", "fill", "tiled", "auto" };
+    return names;
+}
+
+/* The strategy for a request: the fill if there is a template, otherwise the
+ * faster one for the grid's size as measured by benchmark.cpp: up to about
+ * 40x40 the weight approach, above the letters table approach, and for
+ * boards beyond 256x256 its tiled version, which uses all cores.
+ */
+inline const char* best_generator(const GeneratorParams& params) {
+    if (!params.layout.empty()) return "fill";
+    const long cells = long(params.width) * params.height;
+    return cells <= 40 * 40 ? "weight" : cells <= 256 * 256 ? "letters" : "tiled";
+}
+
+/* The strategies an "auto" portfolio (see portfolio.h) takes turns with: the
+ * fill if there is a template, otherwise both others, since which one gives
+ * the denser grid varies from run to run.
+ */
+inline std::vector<std::string> portfolio_generators(const GeneratorParams& params) {
+    if (!params.layout.empty()) return { "fill" };
+    return { "letters", "weight" };
+}
+
+// Dispatches every request to best_generator().
+class AutoGenerator : public Generator {
+public:
+    explicit AutoGenerator(const WordList& wordlist)
+        : m_letters(wordlist), m_weight(wordlist), m_fill(wordlist), m_tiled(wordlist) { }
+
+    const char* name() const override { return "auto"; }
+
+    bool generate(const GeneratorParams& params, GeneratorRng& rng,
+                  Puzzle& puzzle) const override {
+        const std::string best = best_generator(params);
+        const Generator& generator = best == "fill"   ? static_cast<const Generator&>(m_fill)
+                                   : best == "weight" ? static_cast<const Generator&>(m_weight)
+                                   : best == "tiled"  ? static_cast<const Generator&>(m_tiled)
+                                   : m_letters;
+        return generator.generate(params, rng, puzzle);
+    }
+
+private:
+    LettersGenerator m_letters;
+    WeightGenerator m_weight;
+    FillGenerator m_fill;
+    TiledGenerator m_tiled;
+};
+
+// Throws std::invalid_argument for an unknown name.
+inline std::unique_ptr<Generator> make_generator(const std::string& name,
+                                                 const WordList& wordlist) {
+    if (name == "letters") return std::make_unique<LettersGenerator>(wordlist);
+    if (name == "weight")  return std::make_unique<WeightGenerator>(wordlist);
+    if (name == "fill")    return std::make_unique<FillGenerator>(wordlist);
+    if (name == "tiled")   return std::make_unique<TiledGenerator>(wordlist);
+    if (name == "auto")    return std::make_unique<AutoGenerator>(wordlist);
+    throw std::invalid_argument("Unknown generator " + name);
+}
+
+/* Generates 'count' puzzles on 'threads' threads. Puzzle n is generated
+ * with puzzle_rng(seed, n), so the result doesn't depend on the thread count.
+ * A puzzle which couldn't be generated is left empty (0 x 0).
+ */
+inline std::vector<Puzzle> generate_batch(const Generator& generator,
+        const GeneratorParams& params, uint64_t seed, int count, unsigned threads) {
+    std::vector<Puzzle> puzzles(std::max(count, 0));
+    WorkStealingPool pool(std::max(threads, 1u));  // all of them: tiled puzzles split up
+    for (int n = 0; n < count; ++n)
+        pool.submit([&, n] {
+            auto rng = puzzle_rng(seed, n);
+            if (!generator.generate(params, rng, puzzles[n])) puzzles[n] = Puzzle();
+        });
+    pool.wait();
+    return puzzles;
+}
+
+/* Like the above, but hands puzzle n to sink(n, puzzle) on the calling thread
+ * as soon as it and all before it are done, while the pool goes on with the
+ * rest (e.g. to a PuzzleWriter, see puzzle_export.h). A puzzle is dropped once
+ * sunk, so only those waiting for an earlier one are kept.
+ */
+template <class Sink>
+void generate_batch(const Generator& generator, const GeneratorParams& params,
+                    uint64_t seed, int count, unsigned threads, Sink sink) {
+    std::vector<Puzzle> puzzles(std::max(count, 0));
+    std::vector<char> done(puzzles.size(), false);
+    std::mutex mutex;
+    std::condition_variable finished;
+    WorkStealingPool pool(std::max(threads, 1u));  // all of them: tiled puzzles split up
+    for (int n = 0; n < count; ++n)
+        pool.submit([&, n] {
+            auto rng = puzzle_rng(seed, n);
+            Puzzle puzzle;
+            if (!generator.generate(params, rng, puzzle)) puzzle = Puzzle();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                puzzles[n] = std::move(puzzle);
+                done[n] = true;
+            }
+            finished.notify_all();
+        });
+    for (int n = 0; n < count; ++n) {
+        Puzzle puzzle;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return done[n]; });
+            puzzle = std::move(puzzles[n]);
+        }
+        sink(n, puzzle);
+    }
+    pool.wait();
+}
+
+#endif // GENERATORS_H
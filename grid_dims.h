@@ -0,0 +1,55 @@
+/*
+Grid dimensions as template parameter of a grid (see BasicGrid in
+letters_generator.h), so the placement code can be compiled for fixed sizes.
+
+ RuntimeDims      : width and height given at runtime, cells in a vector
+ FixedDims<W, H>  : width and height are constants, cells in a std::array,
+                    so bounds checks and cell index multiplies in the inner
+                    loops fold into constants
+
+Both are constructed from the runtime width and height; FixedDims throws
+std::invalid_argument if they don't match its own.
+*/
+
+#ifndef GRID_DIMS_H
+#define GRID_DIMS_H
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+class RuntimeDims {
+public:
+    static constexpr bool Fixed = false;
+    using Cells = std::vector<char>;
+
+    RuntimeDims(int width, int height) : m_width(width), m_height(height) { }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    Cells cells(char fill) const { return Cells(size_t(m_width) * m_height, fill); }
+
+private:
+    int m_width, m_height;
+};
+
+template <int W, int H>
+class FixedDims {
+public:
+    static constexpr bool Fixed = true;
+    using Cells = std::array<char, W * H>;
+
+    FixedDims(int width, int height) {
+        if (width != W || height != H) throw std::invalid_argument("Grid size mismatch");
+    }
+
+    static constexpr int width() { return W; }
+    static constexpr int height() { return H; }
+    static Cells cells(char fill) {
+        Cells cells;
+        cells.fill(fill);
+        return cells;
+    }
+};
+
+#endif // GRID_DIMS_H
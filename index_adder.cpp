@@ -1,8 +1,15 @@
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 
+#include "binary_dictionary.h"
+#include "dawg.h"
+#include "word_ingester.h"
+
 void print_help()
 {
     std::cout
@@ -12,6 +19,24 @@ void print_help()
     << " xx        : header size\n"
     << " xx xx ... : word length and index to the first word of such size.\n"
     << "!The indices don't include the header's size, so it must handled as offset.\n"
+    << "With option -b the program writes instead a binary dictionary 'bin_<file>',\n"
+    << "which the generators map into memory without parsing (see binary_dictionary.h),\n"
+    << "with option -d a DAWG 'dawg_<file>', a minimal automaton of the words, which the\n"
+    << "generators keep mapped to tell dead slots of a fill (see dawg.h; without weights).\n"
+    << "Both are read back once written, checksum included.\n"
+    << "The dictionary is read in chunks which are normalized in parallel, so it may be\n"
+    << "much larger than the memory; only the kept words are held (see word_ingester.h).\n"
+    << "A line 'word weight' gives the word a weight for the random draws (0 drops it).\n"
+    << "Options:\n"
+    << " -b                : write a binary dictionary\n"
+    << " -d                : write a DAWG\n"
+    << " --non-alpha MODE  : words with other characters than a-z:\n"
+    << "                     abort (default), drop, or translit (drop diacritics)\n"
+    << " --shortest N      : drop words shorter than N letters (default 1)\n"
+    << " --longest N       : drop words longer than N letters (default and at most "
+    << DictMaxWordLength << ")\n"
+    << " --threads T       : normalizing threads (default: all cores)\n"
+    << "Usage: index_adder [-b|-d] [--non-alpha MODE] [--shortest N] [--longest N] [--threads T] dictionary\n"
     ;
 }
 
@@ -20,46 +45,108 @@ int main( int argc, char *argv[] )
     std::ifstream ifs;
     std::ofstream ofs;
     std::string filename;
+    bool binary = false, dawg = false;
+    WordIngester::Options options;
 
-    if( argc <= 1 ) {
+    for( int i = 1; i < argc; ++i ) {
+        std::string arg = argv[i];
+        if( arg == "-b" )
+            binary = true;
+        else if( arg == "-d" )
+            dawg = true;
+        else if( arg == "--non-alpha" && i + 1 < argc ) {
+            std::string mode = argv[++i];
+            if( mode == "abort" )         options.non_alpha = WordIngester::Abort;
+            else if( mode == "drop" )     options.non_alpha = WordIngester::Drop;
+            else if( mode == "translit" ) options.non_alpha = WordIngester::Transliterate;
+            else { print_help(); return 1; }
+        }
+        else if( arg == "--shortest" && i + 1 < argc )
+            options.shortest = std::stoi( argv[++i] );
+        else if( arg == "--longest" && i + 1 < argc )
+            options.longest = std::stoi( argv[++i] );
+        else if( arg == "--threads" && i + 1 < argc )
+            options.threads = std::stoi( argv[++i] );
+        else
+            filename = arg;
+    }
+    if( filename.empty() ) {
         print_help();
         return 1;
     }
-    else {
-        filename = argv[1];
-    }
-    ifs.open( filename );
+    ifs.open( filename, std::ios::binary );
     if( ! ifs ) {
         std::cout << "Dictionary file couldn't opened!\n";
         return 2;
     }
-    ofs.open( std::string("idx_") + filename );
+
+    // sort the words by length
+    WordIngester ingester( options );
+    try {
+        ingester.ingest( ifs );
+    }
+    catch( const std::runtime_error & e ) {
+        std::cerr << e.what() << '\n';
+        return 4;
+    }
+    const auto & stats = ingester.stats();
+    std::cerr << stats.kept << " of " << stats.words << " words kept";
+    if( stats.non_alpha )      std::cerr << ", " << stats.non_alpha << " non-alphabetic dropped";
+    if( stats.transliterated ) std::cerr << ", " << stats.transliterated << " transliterated";
+    if( stats.out_of_range )   std::cerr << ", " << stats.out_of_range << " out of length range";
+    if( stats.banned )         std::cerr << ", " << stats.banned << " with weight 0 dropped";
+    std::cerr << '\n';
+    const std::vector<std::string> & words_table = ingester.buckets();
+    const std::vector<std::vector<float>> & weights = ingester.weights();
+
+    const std::string outname = ( dawg ? "dawg_" : binary ? "bin_" : "idx_" ) + filename;
+    if( dawg || binary )
+        ofs.open( outname, std::ios::binary );
+    else
+        ofs.open( outname );
     if( ! ofs ) {
         std::cout << "Output file couldn't opened!\n";
         return 3;
     }
 
-    // sort the words by length
-    std::vector<std::vector<std::string>> words_table(32);
-    for( std::string word; ifs >> word; )
-    {
-        if( word.size() > 32) continue;
-        for( const auto chr : word ) {
-            if( ! std::isalpha(chr) ) {
-                std::cerr << "The dictionary contains non-alphabetic stuff!\n";
-                return 4;
-            }
+    if( dawg ) {
+        std::vector<std::string_view> words;
+        for( int i = 0; i < int(words_table.size()); ++i )
+            for( size_t pos = 0; pos < words_table[i].size(); pos += i+1 )
+                words.emplace_back( words_table[i].data() + pos, i+1 );
+        try {
+            Dawg( std::move( words ) ).write( ofs );
+            ofs.close();
+            if( ! ofs ) throw std::runtime_error( "Cannot write " + outname );
+            Dawg( outname, true );  // read back, checksum included
+        }
+        catch( const std::runtime_error & e ) {
+            std::cerr << e.what() << '\n';
+            return 5;
         }
-        words_table[word.length() - 1].push_back( word );
+        return 0;
+    }
+    if( binary ) {
+        try {
+            write_binary_dictionary( ofs, words_table, weights );
+            ofs.close();
+            if( ! ofs ) throw std::runtime_error( "Cannot write " + outname );
+            MappedDictionary( outname, true );  // read back, checksum included
+        }
+        catch( const std::runtime_error & e ) {
+            std::cerr << e.what() << '\n';
+            return 5;
+        }
+        return 0;
     }
 
     // generate indices for words lengt and start position in output file
     std::vector<std::pair<int,int>> header;
-    for( int i = 0, count = 0; i < words_table.size(); ++i )
+    for( int i = 0, count = 0; i < int(words_table.size()); ++i )
     {
         if( words_table[i].size() == 0 ) continue;
         header.push_back( std::make_pair( i+1, count ) );
-        count += words_table[i].size();
+        count += words_table[i].size() / (i+1);
     }
        // write the header
     ofs << header.size()+1 << '\n';
@@ -68,13 +155,12 @@ int main( int argc, char *argv[] )
     }
 
     // write the words
-    for( auto & word_list : words_table) {
-        if( word_list.size() == 0 ) continue;
-        for( auto & word : word_list) {
-            for( auto & chr : word ) {
-                chr = std::toupper( chr );
-            }
-            ofs << word << '\n';
+    for( int i = 0; i < int(words_table.size()); ++i ) {
+        const std::string & word_list = words_table[i];
+        for( size_t pos = 0; pos < word_list.size(); pos += i+1 ) {
+            ofs.write( word_list.data() + pos, i+1 );
+            if( ! weights.empty() ) ofs << ' ' << weights[i][pos / (i+1)];
+            ofs << '\n';
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,264 @@
+/*
+Counters and phase timers for the hot paths, compiled in with
+-DCWG_INSTRUMENT only. Without it every CWG_* macro expands to nothing (its
+arguments aren't even evaluated) and the dumps report an empty set.
+
+ CWG_COUNT(name)        : adds 1 to counter 'name'
+ CWG_COUNT_N(name, n)   : adds n
+ CWG_COUNT_AT(counter)  : adds 1 to a counter chosen at runtime
+ CWG_MAX(name, value)   : raises gauge 'name' to 'value'
+ CWG_TIME(name)         : times the enclosing scope as phase 'name'
+
+Each thread counts into its own slots, with plain relaxed loads and stores
+(no read-modify-write), so counting costs about as much as an increment and
+threads never share a cache line. A dump sums the slots of all live threads
+and of those which have ended; it may be taken at any time, from any thread.
+
+ Instrumentation::json(out)       : {"counters":{...},"gauges":{...},"phases":{...}}
+ Instrumentation::prometheus(out) : Prometheus text format
+*/
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Instrumentation {
+public:
+    enum Counter {
+        // letters_generator.h
+        LettersGenerations,
+        LetterDraws,            // letters drawn from the letter table
+        SlotTries,              // slots tested by Grid::can_place()
+        CanPlaceOutOfBounds,    // can_place() failures by reason
+        CanPlaceFlankOccupied,  //  the cell before or after the word
+        CanPlaceSpanOccupied,   //  a cell of the word other than the crossing
+        CanPlaceSideOccupied,   //  a neighbor beside the word
+        PatternMisses,          // slot fits, but no word has the letter there
+        TriesRejected,          // max_tries mode: tries which placed nothing
+        LettersWordsPlaced,
+        LettersExhausted,       // letters dropped since no word fits through them
+        LettersPruned,          // letters dropped by pruning
+        Reseeds,                // seed words placed into empty regions
+        // weight_generator.h
+        WeightGenerations,
+        HighestWeightCalls,
+        WeightPositions,        // positions weighed by highestWeight()
+        WeightWordsPlaced,
+        WeightWordsDropped,     // words which fit nowhere
+        // fill_engine.h
+        FillNodes,
+        FillWipeouts,           // words rejected by forward checking
+        // pattern_cache.h
+        PatternCacheHits,
+        PatternCacheMisses,
+        PatternCacheEvictions,
+        CounterCount
+    };
+    enum Gauge {
+        LetterTableMax,         // largest letter table
+        GaugeCount
+    };
+    enum Phase {
+        LoadWordList,
+        LettersGenerate,
+        WeightGenerate,
+        HighestWeight,
+        Fill,
+        PhaseCount
+    };
+
+#ifdef CWG_INSTRUMENT
+    static constexpr bool enabled() { return true; }
+#else
+    static constexpr bool enabled() { return false; }
+#endif
+
+    static void add(Counter c, uint64_t n = 1) { bump(local().counters[c], n); }
+    static void max(Gauge g, uint64_t value) {
+        auto& slot = local().gauges[g];
+        if (value > slot.load(std::memory_order_relaxed))
+            slot.store(value, std::memory_order_relaxed);
+    }
+
+    class Timer {
+    public:
+        explicit Timer(Phase phase) : m_phase(phase), m_start(Clock::now()) { }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer() {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          Clock::now() - m_start).count();
+            auto& slots = local();
+            bump(slots.phase_ns[m_phase], ns);
+            bump(slots.phase_calls[m_phase], 1);
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        Phase m_phase;
+        Clock::time_point m_start;
+    };
+
+    // Appends all values as one JSON object.
+    static void json(std::string& out) {
+        if (!enabled()) { out += "{}"; return; }
+        const Totals t = totals();
+        out += "{\"counters\":{";
+        for (int c = 0; c < CounterCount; ++c)
+            field(out, c, counter_name(Counter(c)), std::to_string(t.counters[c]));
+        out += "},\"gauges\":{";
+        for (int g = 0; g < GaugeCount; ++g)
+            field(out, g, gauge_name(Gauge(g)), std::to_string(t.gauges[g]));
+        out += "},\"phases\":{";
+        for (int p = 0; p < PhaseCount; ++p)
+            field(out, p, phase_name(Phase(p)),
+                  "{\"calls\":" + std::to_string(t.phase_calls[p])
+                  + ",\"seconds\":" + std::to_string(t.phase_ns[p] * 1e-9) + "}");
+        out += "}}";
+    }
+
+    // Appends all values in the Prometheus text format.
+    static void prometheus(std::string& out) {
+        if (!enabled()) return;
+        const Totals t = totals();
+        for (int c = 0; c < CounterCount; ++c) {
+            std::string name = std::string("cwg_") + counter_name(Counter(c)) + "_total";
+            out += "# TYPE " + name + " counter\n" + name + ' '
+                 + std::to_string(t.counters[c]) + '\n';
+        }
+        for (int g = 0; g < GaugeCount; ++g) {
+            std::string name = std::string("cwg_") + gauge_name(Gauge(g));
+            out += "# TYPE " + name + " gauge\n" + name + ' '
+                 + std::to_string(t.gauges[g]) + '\n';
+        }
+        out += "# TYPE cwg_phase_calls_total counter\n";
+        for (int p = 0; p < PhaseCount; ++p)
+            out += std::string("cwg_phase_calls_total{phase=\"") + phase_name(Phase(p)) + "\"} "
+                 + std::to_string(t.phase_calls[p]) + '\n';
+        out += "# TYPE cwg_phase_seconds_total counter\n";
+        for (int p = 0; p < PhaseCount; ++p)
+            out += std::string("cwg_phase_seconds_total{phase=\"") + phase_name(Phase(p)) + "\"} "
+                 + std::to_string(t.phase_ns[p] * 1e-9) + '\n';
+    }
+
+    static const char* counter_name(Counter c) {
+        static const char* const names[CounterCount] = {
+            "letters_generations", "letter_draws", "slot_tries",
+            "can_place_out_of_bounds", "can_place_flank_occupied",
+            "can_place_span_occupied", "can_place_side_occupied", "pattern_misses",
+            "tries_rejected", "letters_words_placed", "letters_exhausted", "letters_pruned",
+            "reseeds", "weight_generations", "highest_weight_calls", "weight_positions",
+            "weight_words_placed", "weight_words_dropped", "fill_nodes", "fill_wipeouts",
+            "pattern_cache_hits", "pattern_cache_misses", "pattern_cache_evictions" };
+        return names[c];
+    }
+    static const char* gauge_name(Gauge g) {
+        static const char* const names[GaugeCount] = { "letter_table_max" };
+        return names[g];
+    }
+    static const char* phase_name(Phase p) {
+        static const char* const names[PhaseCount] = {
+            "load_word_list", "letters_generate", "weight_generate", "highest_weight", "fill" };
+        return names[p];
+    }
+
+private:
+    using Slot = std::atomic<uint64_t>;
+
+    // The values of one thread.
+    struct alignas(64) Slots {
+        Slot counters[CounterCount] = {};
+        Slot gauges[GaugeCount] = {};
+        Slot phase_calls[PhaseCount] = {};
+        Slot phase_ns[PhaseCount] = {};
+    };
+    struct Totals {
+        uint64_t counters[CounterCount] = {};
+        uint64_t gauges[GaugeCount] = {};
+        uint64_t phase_calls[PhaseCount] = {};
+        uint64_t phase_ns[PhaseCount] = {};
+
+        void add(const Slots& s) {
+            for (int i = 0; i < CounterCount; ++i) counters[i] += s.counters[i].load();
+            for (int i = 0; i < GaugeCount; ++i) gauges[i] = std::max<uint64_t>(gauges[i], s.gauges[i].load());
+            for (int i = 0; i < PhaseCount; ++i) phase_calls[i] += s.phase_calls[i].load();
+            for (int i = 0; i < PhaseCount; ++i) phase_ns[i] += s.phase_ns[i].load();
+        }
+    };
+    struct Registry {
+        std::mutex mutex;
+        std::vector<Slots*> live;
+        Totals retired;  // of the threads which have ended
+    };
+
+    // Registers the thread's slots on first use and folds them into the
+    // retired totals when the thread ends.
+    struct Local {
+        Slots slots;
+        Local() {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().live.push_back(&slots);
+        }
+        ~Local() {
+            auto& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.retired.add(slots);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), &slots));
+        }
+    };
+
+    static Registry& registry() {
+        static Registry* r = new Registry;  // outlives the threads' Locals
+        return *r;
+    }
+    static Slots& local() {
+        thread_local Slots* slots = nullptr;  // trivial, so no init guard on each access
+        if (!slots) {
+            thread_local Local l;
+            slots = &l.slots;
+        }
+        return *slots;
+    }
+    static void bump(Slot& slot, uint64_t n) {
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static Totals totals() {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        Totals t = r.retired;
+        for (const Slots* s : r.live) t.add(*s);
+        return t;
+    }
+
+    static void field(std::string& out, int i, const char* name, const std::string& value) {
+        if (i) out += ',';
+        out += std::string("\"") + name + "\":" + value;
+    }
+};
+
+#ifdef CWG_INSTRUMENT
+#define CWG_CONCAT2(a, b) a##b
+#define CWG_CONCAT(a, b) CWG_CONCAT2(a, b)
+#define CWG_COUNT(name)       Instrumentation::add(Instrumentation::name)
+#define CWG_COUNT_N(name, n)  Instrumentation::add(Instrumentation::name, (n))
+#define CWG_COUNT_AT(counter) Instrumentation::add(counter)
+#define CWG_MAX(name, value)  Instrumentation::max(Instrumentation::name, (value))
+#define CWG_TIME(name) \
+    Instrumentation::Timer CWG_CONCAT(cwg_timer_, __LINE__)(Instrumentation::name)
+#else
+#define CWG_COUNT(name)       ((void)0)
+#define CWG_COUNT_N(name, n)  ((void)0)
+#define CWG_COUNT_AT(counter) ((void)0)
+#define CWG_MAX(name, value)  ((void)0)
+#define CWG_TIME(name)        ((void)0)
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,728 @@
+/*
+The letters table approach (formerly crossword_puzzle_generator_2_dutch.cpp
+and crossword_puzzle_generator_dutch.cpp).
+
+The algorithm keeps track of the row/col position (and horz/vert direction) of
+the letters on the grid. Knowing the horz/vert direction means we only need to
+test the opposite direction when adding a word crossing that letter.
+
+An initial word is placed at position 0,0 (randomly horz or vert).
+Then words are placed, connected to already-placed words, until no letter in
+the letter table can be crossed any more.
+
+To place a word, a random letter of the letter table is picked, and the slots
+(word length and offset) through it are tested in random order. For a slot
+which fits the grid, the dictionary's pattern index (see pattern_index.h)
+yields the words having that letter at that offset, and a random one of them
+is placed. When a letter in the letter table is "double-crossed", it is removed
+from the table since it can't be used again. A letter where no slot fits is
+removed as well: the grid only fills up, so it won't fit later either.
+
+With GeneratorParams::max_tries set, a random letter and a random slot are
+drawn per try instead, and generation stops after max_tries failed tries in a
+row (the way the dutch variant worked).
+
+With GeneratorParams::prune set, letters which obviously can't be crossed
+(due to close letters on either side) are removed from the table as soon as
+a word is placed next to them, so they are never drawn.
+
+With GeneratorParams::reseed set, generation doesn't end there: a new seed
+word is placed on the longest run of clear cells, and crossing words are
+placed from its letters, until no run has room for a word. For that the grid
+counts the letters in and next to each cell as words are added and taken
+back, so a cell with count 0 is "clear": any run of clear cells can take a
+word. The longest clear run of every row and column is kept, and a line is
+only scanned again once one of its cells turned clear or unclear, so a
+reseed costs the lines the words since the last one touched, not the whole
+grid. A seed word can't cross the words placed so far (their letters can't
+be crossed any more, or the table wouldn't be empty) and mustn't touch them,
+and a crossing word only ever touches the letter it crosses, so every seed
+starts an island of its own: a reseeded puzzle is made of several
+crosswords which aren't connected.
+
+With GeneratorParams::beat set, generation gives up once the grid can't end
+up with more letters: as a new word only ever touches the letter it crosses,
+an empty cell next to a letter which left the letter table stays empty, so
+the letters and the other empty cells are a bound. The grid counts the
+letters out of the table next to each cell as letters leave the table and
+come back, and so the empty cells next to them.
+
+Problems:
+
+Without reseeding this may leave some empty spots, although it seems to work
+pretty well.
+*/
+
+#ifndef LETTERS_GENERATOR_H
+#define LETTERS_GENERATOR_H
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "generator.h"
+#include "grid_dims.h"
+#include "instrumentation.h"
+#include "occupancy.h"
+#include "word_list.h"
+
+class Dir {
+public:
+    enum DirT { Horz, Vert };
+    template <class Rng>
+    static Dir rnd_dir(Rng& rng) {
+        return Dir(random_below(rng, 2) ? Horz : Vert);
+    }
+    Dir(DirT dir) : m_dir(dir) { }
+    bool horz() const { return m_dir == Horz; }
+    bool vert() const { return m_dir == Vert; }
+    Dir operator!() const { return m_dir == Horz ? Vert : Horz; }
+    friend std::ostream& operator<<(std::ostream& out, Dir dir) {
+        return out << (dir.m_dir == Horz ? 'H' : 'V');
+    }
+private:
+    DirT m_dir;
+};
+
+struct Point {
+    int row, col;
+    Dir dir;
+    Point(int r, int c, Dir d) : row(r), col(c), dir(d) { }
+    bool operator==(const Point& p) const
+         { return row == p.row && col == p.col; }
+    bool operator!=(const Point& p) const { return !(*this == p); }
+};
+
+/* The letter table: the positions of all letters on the grid which may still
+ * be crossed, and their letters.
+ *
+ * The table is allocated once for the whole grid (a cell holds at most one
+ * entry) and doesn't allocate afterwards. Positions are packed into 32 bits
+ * (16 bits row, 15 bits column, 1 bit direction) and kept apart from the
+ * letters. An entry is removed by moving the last entry into its place, and
+ * a cell index finds the entry of a cell, both in O(1).
+ */
+class Letters {
+public:
+    static constexpr int MaxRows = 1 << 16, MaxCols = 1 << 15;
+
+    Letters(int width, int height)
+        : m_width(width), m_points(size_t(width) * height),
+          m_letters(size_t(width) * height), m_index(size_t(width) * height, -1) {
+        if (width > MaxCols || height > MaxRows)
+            throw std::invalid_argument("Grid too large for the letter table");
+    }
+
+    size_t size() const { return m_size; }
+    Point point(size_t i) const { return unpack(m_points[i]); }
+    char letter(size_t i) const { return m_letters[i]; }
+
+    void push_back(Point p, char ch) {
+        m_index[cell(p.row, p.col)] = m_size;
+        m_points[m_size] = pack(p);
+        m_letters[m_size++] = ch;
+    }
+
+    void erase(size_t i) {
+        Point p = point(i);
+        m_index[cell(p.row, p.col)] = -1;
+        if (i != --m_size) {
+            m_points[i]  = m_points[m_size];
+            m_letters[i] = m_letters[m_size];
+            Point last = point(i);
+            m_index[cell(last.row, last.col)] = i;
+        }
+    }
+
+    // The entry of the cell, or -1 if it has none.
+    long find(int row, int col) const { return m_index[cell(row, col)]; }
+
+    // For undoing changes: the packed position of entry i, the undo of
+    // push_back(), and the undo of erase(i) with the erased entry.
+    uint32_t packed(size_t i) const { return m_points[i]; }
+    void pop_back() {
+        Point p = point(--m_size);
+        m_index[cell(p.row, p.col)] = -1;
+    }
+    void restore(size_t i, uint32_t packed, char ch) {
+        if (i != m_size) {
+            m_points[m_size]  = m_points[i];
+            m_letters[m_size] = m_letters[i];
+            Point moved = point(m_size);
+            m_index[cell(moved.row, moved.col)] = m_size;
+        }
+        ++m_size;
+        m_points[i]  = packed;
+        m_letters[i] = ch;
+        Point p = point(i);
+        m_index[cell(p.row, p.col)] = i;
+    }
+
+    void dump() const {
+        for (char ch = 'A'; ch <= 'Z'; ++ch) {
+            std::cout << ch << ": ";
+            for (size_t i = 0; i < m_size; ++i) {
+                if (m_letters[i] != ch) continue;
+                Point p = point(i);
+                std::cout << p.row << ',' << p.col << ',' << p.dir << "  ";
+            }
+            std::cout << '\n';
+        }
+    }
+
+private:
+    static uint32_t pack(Point p)
+        { return uint32_t(p.row) << 16 | uint32_t(p.col) << 1 | p.dir.vert(); }
+    static Point unpack(uint32_t v)
+        { return Point(v >> 16, v >> 1 & (MaxCols - 1), v & 1 ? Dir::Vert : Dir::Horz); }
+    size_t cell(int row, int col) const { return size_t(row) * m_width + col; }
+
+    int m_width;
+    size_t m_size = 0;
+    std::vector<uint32_t> m_points;
+    std::vector<char> m_letters;
+    std::vector<int32_t> m_index;  // per cell
+};
+
+/* The grid of the letters table approach.
+ *
+ * All changes of a generation can be taken back: checkpoint() starts an undo
+ * log which records every changed cell (with its occupancy bit) and every
+ * entry added to or removed from the letter table, and rollback() takes the
+ * changes back to a checkpoint, in time proportional to the changes. For
+ * going back further, snapshot() copies the whole state into flat arrays and
+ * restore() copies it back without allocating.
+ *
+ * Dims (see grid_dims.h) gives the grid's size: with FixedDims it is known at
+ * compile time, so the index and bounds arithmetic of can_place() and
+ * add_word() is done on constants and the cells live in a std::array.
+ * LettersGenerator uses that for common square sizes; Grid is the runtime
+ * sized fallback.
+ */
+template <class Dims>
+class BasicGrid {
+    void add_word(std::string_view word, int w, Point cross_pnt);
+    bool try_crossing_word();
+    bool crossable(Point p) const;
+    void prune_around(int row, int col);
+    Instrumentation::Counter blocked(bool horz, int line, int start, int size,
+                                     uint64_t crossing) const;
+    void set_cell(const Point& p, char ch);
+    void push_letter(Point p, char ch);
+    void erase_letter(size_t i);
+    void mark_near(int row, int col, int delta);
+    void mark_dead(int row, int col, int delta);
+    bool reseed();
+public:
+    static constexpr char Empty = '.';
+
+    BasicGrid(const WordList& wordlist, const GeneratorParams& params, GeneratorRng& rng)
+        : m_dims(params.width, params.height),
+          m_grid(m_dims.cells(Empty)), m_occ(width(), height()),
+          m_letters(width(), height()),
+          m_words(wordlist), m_params(params), m_rng(rng) {
+        if (params.longest > int(PatternIndex::MaxLength))
+            throw std::invalid_argument("Words too long for the pattern index");
+        for (int size = params.shortest; size <= params.longest; ++size)
+            for (int w = 0; w < size; ++w)
+                m_slots.emplace_back(size, w);
+        if (params.reseed) {
+            m_near.assign(size_t(width()) * height(), 0);
+            m_runs.resize(height() + width());
+            m_stale.assign(height() + width(), true);
+        }
+        if (params.beat) m_dead_near.assign(size_t(width()) * height(), 0);
+    }
+
+    char* operator[](size_t row) { return &m_grid[row * width()]; }
+    const char* operator[](size_t row) const { return &m_grid[row * width()]; }
+    char& operator[](const Point& p) { return m_grid[p.row * width() + p.col]; }
+    int width() const { return m_dims.width(); }
+    int height() const { return m_dims.height(); }
+    bool empty(int r, int c) const { return m_grid[r * width() + c] == Empty; }
+    bool can_place(int size, int w, const Point& p) const;
+
+    // Returns false if cancelled or beaten, see GeneratorParams.
+    bool generate();
+    void place_initial_word(std::string_view word);
+    bool place_crossing_word();
+    void print(std::ostream& out = std::cout) const;
+
+    struct Snapshot {
+        typename Dims::Cells grid;
+        Occupancy occ;
+        Letters letters;
+        std::vector<uint8_t> near, dead_near;
+        int dead;
+    };
+    // Starts logging changes (if not yet) and returns the current position.
+    size_t checkpoint() { m_logging = true; return m_undo.size(); }
+    // Takes back all changes since the checkpoint.
+    void rollback(size_t checkpoint);
+    // Stops logging and drops the log; older checkpoints are void.
+    void commit() { m_logging = false; m_undo.clear(); }
+    Snapshot snapshot() const
+        { return Snapshot{ m_grid, m_occ, m_letters, m_near, m_dead_near, m_dead }; }
+    // Returns to the snapshot; checkpoints are void.
+    void restore(const Snapshot& s) {
+        m_grid = s.grid;
+        m_occ = s.occ;
+        m_letters = s.letters;
+        m_near = s.near;
+        m_dead_near = s.dead_near;
+        m_dead = s.dead;
+        std::fill(m_stale.begin(), m_stale.end(), true);
+        m_undo.clear();
+    }
+
+private:
+    // An entry of the undo log.
+    struct Change {
+        enum Kind : uint8_t { Cell, Push, Erase };
+        Kind kind;
+        char letter;     // Erase: the erased letter
+        uint32_t index;  // Cell: the cell; Erase: the letter table entry
+        uint32_t packed; // Erase: the erased position
+    };
+
+    // Grids up to 64x64 have bitboards, for fixed dimensions known at compile time.
+    bool bitboards() const {
+        if constexpr (Dims::Fixed)
+            return Dims::width() <= Occupancy::MaxSize && Dims::height() <= Occupancy::MaxSize;
+        else
+            return m_occ.enabled();
+    }
+
+    // A run of cells in a row (horz) or column.
+    struct Run {
+        int len = 0, row = 0, col = 0;
+        bool horz = true;
+    };
+
+    Dims m_dims;
+    typename Dims::Cells m_grid;
+    Occupancy m_occ;  // kept in sync with m_grid by add_word
+    Letters m_letters;
+    std::vector<uint8_t> m_near;   // reseed: letters in and next to each cell
+    std::vector<Run> m_runs;       // reseed: longest clear run of each row, then column
+    std::vector<char> m_stale;     // reseed: per line as m_runs, a cell turned (un)clear
+    std::vector<uint8_t> m_dead_near; // beat: letters out of the table next to each cell
+    int m_dead = 0;                // beat: empty cells next to such letters
+    std::vector<std::pair<int, int>> m_slots; // (size, w) of all slots through a letter
+    std::vector<std::pair<int, int>> m_order; // m_slots in random order
+    std::vector<Change> m_undo;
+    bool m_logging = false;
+    const WordList& m_words;
+    const GeneratorParams& m_params;
+    GeneratorRng& m_rng;
+};
+
+using Grid = BasicGrid<RuntimeDims>;
+
+template <class Dims>
+inline void BasicGrid<Dims>::set_cell(const Point& p, char ch) {
+    if (m_logging) m_undo.push_back(Change{ Change::Cell, 0, uint32_t(p.row * width() + p.col), 0 });
+    (*this)[p] = ch;
+    if (bitboards()) m_occ.set(p.row, p.col);
+    if (!m_near.empty()) mark_near(p.row, p.col, 1);
+    if (!m_dead_near.empty() && m_dead_near[p.row * width() + p.col]) --m_dead;
+}
+
+/* Adds delta to the near counts of a cell and its neighbors; the lines of
+ * a cell which turns clear or unclear need a new longest run.
+ */
+template <class Dims>
+inline void BasicGrid<Dims>::mark_near(int row, int col, int delta) {
+    auto mark = [&](int r, int c) {
+        uint8_t& near = m_near[r * width() + c];
+        if (near == 0 || near + delta == 0) m_stale[r] = m_stale[height() + c] = true;
+        near += delta;
+    };
+    mark(row, col);
+    if (row > 0)            mark(row - 1, col);
+    if (row < height() - 1) mark(row + 1, col);
+    if (col > 0)            mark(row, col - 1);
+    if (col < width() - 1)  mark(row, col + 1);
+}
+
+/* Adds delta to the dead counts of the neighbors of a letter which leaves
+ * (1) or comes back to (-1) the letter table.
+ */
+template <class Dims>
+inline void BasicGrid<Dims>::mark_dead(int row, int col, int delta) {
+    auto mark = [&](int r, int c) {
+        uint8_t& dead = m_dead_near[r * width() + c];
+        if ((dead == 0 || dead + delta == 0) && empty(r, c)) m_dead += delta;
+        dead += delta;
+    };
+    if (row > 0)            mark(row - 1, col);
+    if (row < height() - 1) mark(row + 1, col);
+    if (col > 0)            mark(row, col - 1);
+    if (col < width() - 1)  mark(row, col + 1);
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::push_letter(Point p, char ch) {
+    if (m_logging) m_undo.push_back(Change{ Change::Push, 0, 0, 0 });
+    m_letters.push_back(p, ch);
+    CWG_MAX(LetterTableMax, m_letters.size());
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::erase_letter(size_t i) {
+    if (m_logging)
+        m_undo.push_back(Change{ Change::Erase, m_letters.letter(i), uint32_t(i),
+                                 m_letters.packed(i) });
+    if (!m_dead_near.empty()) mark_dead(m_letters.point(i).row, m_letters.point(i).col, 1);
+    m_letters.erase(i);
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::rollback(size_t checkpoint) {
+    for (; m_undo.size() > checkpoint; m_undo.pop_back()) {
+        const Change& c = m_undo.back();
+        switch (c.kind) {
+        case Change::Cell:
+            m_grid[c.index] = Empty;
+            if (bitboards()) m_occ.reset(c.index / width(), c.index % width());
+            if (!m_near.empty()) mark_near(c.index / width(), c.index % width(), -1);
+            if (!m_dead_near.empty() && m_dead_near[c.index]) ++m_dead;
+            break;
+        case Change::Push:
+            m_letters.pop_back();
+            break;
+        case Change::Erase:
+            m_letters.restore(c.index, c.packed, c.letter);
+            if (!m_dead_near.empty())
+                mark_dead(m_letters.point(c.index).row, m_letters.point(c.index).col, -1);
+            break;
+        }
+    }
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::print(std::ostream& out) const {
+    std::string text;  // written at once
+    text.reserve(size_t(2 * width() + 1) * height());
+    for (int r = 0; r < height(); ++r) {
+        for (int c = 0; c < width(); ++c) {
+            char ch = std::toupper(m_grid[r * width() + c]);
+            text += ch == '.' ? ' ' : ch;
+            text += ' ';
+        }
+        text += '\n';
+    }
+    out.write(text.data(), text.size());
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::add_word(std::string_view word, int w, Point cross_pnt) {
+    Point pnt(cross_pnt);
+    pnt.dir = !pnt.dir;
+    int& colrow = (pnt.dir.horz() ? pnt.col : pnt.row);
+    colrow -= w;
+    int start = colrow;
+    for (unsigned pos = start, w = 0; pos < start + word.size(); ++pos) {
+        char ch = word[w++];
+        colrow = pos; // set pnt.col or pnt.row to pos
+        if (pnt == cross_pnt) continue;
+        push_letter(pnt, ch);
+        set_cell(pnt, ch);
+    }
+    if (!m_params.prune) return;
+    colrow = start;
+    for (unsigned pos = start; pos < start + word.size(); ++pos) {
+        colrow = pos;
+        prune_around(pnt.row, pnt.col);
+    }
+}
+
+template <class Dims>
+inline void BasicGrid<Dims>::place_initial_word(std::string_view word) {
+    Point cross_pnt(0, 0, Dir::rnd_dir(m_rng));
+    push_letter(cross_pnt, word[0]);
+    set_cell(cross_pnt, word[0]);
+    add_word(word, 0, cross_pnt);
+}
+
+/* Places a seed word on the longest run of clear cells, at a random offset.
+ * Returns false if no run has room for a word.
+ */
+template <class Dims>
+inline bool BasicGrid<Dims>::reseed() {
+    for (int line = 0; line < height() + width(); ++line) {
+        if (!m_stale[line]) continue;
+        m_stale[line] = false;
+        const bool horz = line < height();
+        const int l = horz ? line : line - height(), len = horz ? width() : height();
+        auto clear = [&](int k) { return m_near[horz ? l * width() + k : k * width() + l] == 0; };
+        Run& best = m_runs[line];
+        best = Run();
+        for (int i = 0; i < len; ) {
+            if (!clear(i)) { ++i; continue; }
+            int start = i;
+            while (i < len && clear(i)) ++i;
+            if (i - start > best.len) best = Run{ i - start, horz ? l : start, horz ? start : l, horz };
+        }
+    }
+    const Run* longest = nullptr;
+    for (const Run& r : m_runs)
+        if (!longest || r.len > longest->len) longest = &r;
+    if (longest->len < m_params.shortest) return false;
+
+    const Run& run = *longest;
+    uint32_t id;
+    if (!m_words.rnd_word(m_rng, m_params.shortest, std::min(m_params.longest, run.len), id))
+        return false;
+    const std::string_view word = m_words.word_view(id);
+    const int offset = random_below(m_rng, run.len - word.size() + 1);
+    const Dir dir(run.horz ? Dir::Horz : Dir::Vert);
+    const Point first(run.row + (run.horz ? 0 : offset), run.col + (run.horz ? offset : 0), dir);
+    push_letter(first, word[0]);
+    set_cell(first, word[0]);
+    add_word(word, 0, Point(first.row, first.col, !dir));
+    CWG_COUNT(Reseeds);
+    return true;
+}
+
+/* A quick test if a word may ever cross p: the cells before and after p in
+ * the crossing direction must not be occupied, and at least one of them must
+ * be inside the grid and have empty cells on both sides. The grid only fills
+ * up, so a letter failing this test never passes it later.
+ */
+template <class Dims>
+inline bool BasicGrid<Dims>::crossable(Point p) const {
+    const int dr = p.dir.horz(), dc = p.dir.vert();  // the crossing direction
+    bool usable = false;
+    for (int s = -1; s <= 1; s += 2) {
+        int r = p.row + s * dr, c = p.col + s * dc;
+        if (r < 0 || r >= height() || c < 0 || c >= width()) continue;
+        if (!empty(r, c)) return false;
+        usable = usable || (   (r - dc < 0         || c - dr < 0        || empty(r - dc, c - dr))
+                            && (r + dc >= height() || c + dr >= width() || empty(r + dc, c + dr)));
+    }
+    return usable;
+}
+
+// Removes the letters around a new letter at row, col which can't be crossed any more.
+template <class Dims>
+inline void BasicGrid<Dims>::prune_around(int row, int col) {
+    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, height() - 1); ++r)
+        for (int c = std::max(col - 1, 0); c <= std::min(col + 1, width() - 1); ++c) {
+            long i = m_letters.find(r, c);
+            if (i >= 0 && !crossable(m_letters.point(i))) {
+                CWG_COUNT(LettersPruned);
+                erase_letter(i);
+            }
+        }
+}
+
+/* Tests if a word of the given size fits the grid, crossing p with its w'th
+ * letter. Only the letter at p is tested by the pattern index, the other
+ * places need to be empty. Grids up to 64x64 are tested on the occupancy
+ * bitboards, larger ones cell by cell.
+ */
+template <class Dims>
+inline bool BasicGrid<Dims>::can_place(int size, int w, const Point& p) const {
+    CWG_COUNT(SlotTries);
+    int r = p.row, c = p.col;
+    Dir dir = !p.dir;
+    if (dir.horz()) {
+        c -= w;
+        if (c < 0 || c + size > width()) {
+            CWG_COUNT(CanPlaceOutOfBounds);
+            return false;
+        }
+        if (bitboards()) {
+            bool free = m_occ.span_free(true, r, c, size, Occupancy::bit(c + w));
+            if (!free) CWG_COUNT_AT(blocked(true, r, c, size, Occupancy::bit(c + w)));
+            return free;
+        }
+        if (   (c > 0              && !empty(r, c - 1))
+            || (c + size < width() && !empty(r, c + size))) {
+            CWG_COUNT(CanPlaceFlankOccupied);
+            return false;
+        }
+        for (int i = 0; i < size; ++i, ++c) {
+            if (i == w) continue;
+            if (!empty(r, c)) {
+                CWG_COUNT(CanPlaceSpanOccupied);
+                return false;
+            }
+            if (   (r > 0            && !empty(r - 1, c))
+                || (r < height() - 1 && !empty(r + 1, c))) {
+                CWG_COUNT(CanPlaceSideOccupied);
+                return false;
+            }
+        }
+    }
+    else {
+        r -= w;
+        if (r < 0 || r + size > height()) {
+            CWG_COUNT(CanPlaceOutOfBounds);
+            return false;
+        }
+        if (bitboards()) {
+            bool free = m_occ.span_free(false, c, r, size, Occupancy::bit(r + w));
+            if (!free) CWG_COUNT_AT(blocked(false, c, r, size, Occupancy::bit(r + w)));
+            return free;
+        }
+        if (   (r > 0               && !empty(r - 1,    c))
+            || (r + size < height() && !empty(r + size, c))) {
+            CWG_COUNT(CanPlaceFlankOccupied);
+            return false;
+        }
+        for (int i = 0; i < size; ++i, ++r) {
+            if (i == w) continue;
+            if (!empty(r, c)) {
+                CWG_COUNT(CanPlaceSpanOccupied);
+                return false;
+            }
+            if (   (c > 0           && !empty(r, c - 1))
+                || (c < width() - 1 && !empty(r, c + 1))) {
+                CWG_COUNT(CanPlaceSideOccupied);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Why a span failed Occupancy::span_free(), for the can_place() counters.
+template <class Dims>
+inline Instrumentation::Counter BasicGrid<Dims>::blocked(bool horz, int line, int start, int size,
+                                              uint64_t crossing) const {
+    const uint64_t cells = m_occ.line(horz, line);
+    if (cells & (Occupancy::bit(start - 1) | Occupancy::bit(start + size)))
+        return Instrumentation::CanPlaceFlankOccupied;
+    if (cells & Occupancy::span(start, size) & ~crossing)
+        return Instrumentation::CanPlaceSpanOccupied;
+    return Instrumentation::CanPlaceSideOccupied;
+}
+
+template <class Dims>
+inline bool BasicGrid<Dims>::place_crossing_word() {
+    for (size_t count; (count = m_letters.size()) > 0; ) {
+        // pick a random letter of the letter table
+        size_t n = random_below(m_rng, count);
+        const Point p = m_letters.point(n);
+        const char ch = m_letters.letter(n);
+        CWG_COUNT(LetterDraws);
+
+        m_order = m_slots;  // from the same order each time, see rollback()
+        random_order(m_order.begin(), m_order.end(), m_rng);
+        for (auto [size, w] : m_order) {
+            if (!can_place(size, w, p)) continue;
+            char pattern[PatternIndex::MaxLength];
+            std::fill(pattern, pattern + size, '?');
+            pattern[w] = ch;
+            uint32_t id;
+            if (!m_words.pick(std::string_view(pattern, size), m_rng, id)) {
+                CWG_COUNT(PatternMisses);
+                continue;
+            }
+            erase_letter(n); // erase "double-crossed" letters from list
+            add_word(m_words.word_view(id), w, p);
+            CWG_COUNT(LettersWordsPlaced);
+            return true;
+        }
+        CWG_COUNT(LettersExhausted);
+        erase_letter(n); // no word can cross this letter
+    }
+    return false;
+}
+
+/* Picks a random letter position and a random slot through it, up to
+ * max_tries times, and places a word there if the slot fits.
+ */
+template <class Dims>
+inline bool BasicGrid<Dims>::try_crossing_word() {
+    for (int i = 0; i < m_params.max_tries; ++i) {
+        size_t count = m_letters.size();
+        if (count == 0) return false;
+        size_t n = random_below(m_rng, count);
+        const Point p = m_letters.point(n);
+        CWG_COUNT(LetterDraws);
+
+        int size = random_between(m_rng, m_params.shortest, m_params.longest);
+        int w = random_below(m_rng, size);
+        if (!can_place(size, w, p)) {
+            CWG_COUNT(TriesRejected);
+            continue;
+        }
+        char pattern[PatternIndex::MaxLength];
+        std::fill(pattern, pattern + size, '?');
+        pattern[w] = m_letters.letter(n);
+        uint32_t id;
+        if (!m_words.pick(std::string_view(pattern, size), m_rng, id)) {
+            CWG_COUNT(PatternMisses);
+            CWG_COUNT(TriesRejected);
+            continue;
+        }
+        erase_letter(n);
+        add_word(m_words.word_view(id), w, p);
+        CWG_COUNT(LettersWordsPlaced);
+        return true;
+    }
+    return false;
+}
+
+template <class Dims>
+inline bool BasicGrid<Dims>::generate() {
+    CWG_TIME(LettersGenerate);
+    CWG_COUNT(LettersGenerations);
+    const int longest = std::min(m_params.longest, std::min(width(), height()));
+    uint32_t id;
+    if (!m_words.rnd_word(m_rng, m_params.shortest, longest, id)) return true;
+    place_initial_word(m_words.word_view(id));
+    for (;;) {
+        if (m_params.cancelled() || m_params.beaten(width() * height() - m_dead)) return false;
+        if (m_params.max_tries > 0 ? try_crossing_word() : place_crossing_word()) continue;
+        if (!m_params.reseed || !reseed()) return true;
+    }
+}
+
+class LettersGenerator : public Generator {
+public:
+    explicit LettersGenerator(const WordList& wordlist) : m_words(wordlist) { }
+
+    const char* name() const override { return "letters"; }
+
+    bool generate(const GeneratorParams& params, GeneratorRng& rng,
+                  Puzzle& puzzle) const override {
+        if (params.width < 1 || params.height < 1 || params.shortest < 1
+         || params.shortest > params.longest)
+            throw std::invalid_argument("Bad grid or word size");
+        if (params.width == params.height) {
+            switch (params.width) {
+            case 13: return generate<FixedDims<13, 13>>(params, rng, puzzle);
+            case 15: return generate<FixedDims<15, 15>>(params, rng, puzzle);
+            case 21: return generate<FixedDims<21, 21>>(params, rng, puzzle);
+            case 30: return generate<FixedDims<30, 30>>(params, rng, puzzle);
+            case 64: return generate<FixedDims<64, 64>>(params, rng, puzzle);  // tiled_generator.h
+            }
+        }
+        return generate<RuntimeDims>(params, rng, puzzle);
+    }
+
+private:
+    template <class Dims>
+    bool generate(const GeneratorParams& params, GeneratorRng& rng, Puzzle& puzzle) const {
+        BasicGrid<Dims> grid(m_words, params, rng);
+        const bool done = grid.generate();  // the grid so far if not
+        puzzle = Puzzle(grid.width(), grid.height());
+        for (int r = 0; r < grid.height(); ++r)
+            std::copy(grid[r], grid[r] + grid.width(), puzzle[r]);
+        return done;
+    }
+
+    const WordList& m_words;
+};
+
+#endif // LETTERS_GENERATOR_H
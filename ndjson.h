@@ -0,0 +1,202 @@
+/*
+Just enough JSON for newline-delimited requests and results: one flat object
+per line, whose values are strings, numbers, booleans, null or arrays of
+those. Nested objects are rejected.
+
+ JsonObject::parse : parses one line, throws std::invalid_argument
+ json_string       : appends a string as JSON string literal
+*/
+
+#ifndef NDJSON_H
+#define NDJSON_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array };
+    Type type = Null;
+    bool boolean = false;
+    double number = 0;
+    std::string text;              // the decoded string
+    std::vector<JsonValue> items;  // the array's elements
+    std::string raw;               // the value as written, e.g. to echo it back
+};
+
+// Appends 's' to 'out' as JSON string literal.
+inline void json_string(std::string& out, std::string_view s) {
+    out += '"';
+    for (char ch : s) {
+        switch (ch) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                out += buf;
+            }
+            else out += ch;
+        }
+    }
+    out += '"';
+}
+
+class JsonObject {
+public:
+    static JsonObject parse(std::string_view line) {
+        JsonObject obj;
+        Parser p{ line };
+        p.expect('{');
+        if (!p.accept('}')) {
+            do {
+                std::string key = p.string();
+                p.expect(':');
+                obj.m_values[key] = p.value();
+            } while (p.accept(','));
+            p.expect('}');
+        }
+        p.skip();
+        if (p.pos != line.size()) p.fail("trailing characters");
+        return obj;
+    }
+
+    const JsonValue* find(const std::string& key) const {
+        auto it = m_values.find(key);
+        return it == m_values.end() ? nullptr : &it->second;
+    }
+
+    // The number at 'key', or 'def' if there is none.
+    double number(const std::string& key, double def) const {
+        const JsonValue* v = find(key);
+        if (!v) return def;
+        if (v->type != JsonValue::Number) throw std::invalid_argument(key + " must be a number");
+        return v->number;
+    }
+
+    // The boolean at 'key', or 'def' if there is none.
+    bool boolean(const std::string& key, bool def) const {
+        const JsonValue* v = find(key);
+        if (!v) return def;
+        if (v->type != JsonValue::Bool) throw std::invalid_argument(key + " must be a boolean");
+        return v->boolean;
+    }
+
+    // The string at 'key', or 'def' if there is none.
+    std::string string(const std::string& key, const std::string& def) const {
+        const JsonValue* v = find(key);
+        if (!v) return def;
+        if (v->type != JsonValue::String) throw std::invalid_argument(key + " must be a string");
+        return v->text;
+    }
+
+private:
+    struct Parser {
+        std::string_view s;
+        size_t pos = 0;
+
+        [[noreturn]] void fail(const char* what) const {
+            throw std::invalid_argument(std::string("JSON: ") + what + " at "
+                                        + std::to_string(pos));
+        }
+        void skip() {
+            while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r'
+                                   || s[pos] == '\n')) ++pos;
+        }
+        bool accept(char ch) {
+            skip();
+            if (pos < s.size() && s[pos] == ch) { ++pos; return true; }
+            return false;
+        }
+        void expect(char ch) { if (!accept(ch)) fail("unexpected character"); }
+        bool literal(std::string_view word) {
+            if (s.substr(pos, word.size()) != word) return false;
+            pos += word.size();
+            return true;
+        }
+
+        std::string string() {
+            skip();
+            if (pos >= s.size() || s[pos] != '"') fail("string expected");
+            std::string out;
+            for (++pos; pos < s.size() && s[pos] != '"'; ++pos) {
+                if (s[pos] != '\\') { out += s[pos]; continue; }
+                if (++pos >= s.size()) break;
+                switch (s[pos]) {
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (pos + 4 >= s.size()) fail("bad escape");
+                    unsigned code = std::strtoul(std::string(s.substr(pos + 1, 4)).c_str(),
+                                                 nullptr, 16);
+                    pos += 4;
+                    if (code < 0x80) out += char(code);
+                    else if (code < 0x800) {
+                        out += char(0xc0 | code >> 6);
+                        out += char(0x80 | (code & 0x3f));
+                    }
+                    else {
+                        out += char(0xe0 | code >> 12);
+                        out += char(0x80 | (code >> 6 & 0x3f));
+                        out += char(0x80 | (code & 0x3f));
+                    }
+                    break;
+                }
+                default: out += s[pos];
+                }
+            }
+            if (pos >= s.size()) fail("unterminated string");
+            ++pos;
+            return out;
+        }
+
+        JsonValue value() {
+            skip();
+            JsonValue v;
+            const size_t start = pos;
+            if (pos >= s.size()) fail("value expected");
+            if (s[pos] == '"') {
+                v.type = JsonValue::String;
+                v.text = string();
+            }
+            else if (s[pos] == '[') {
+                v.type = JsonValue::Array;
+                ++pos;
+                if (!accept(']')) {
+                    do v.items.push_back(value()); while (accept(','));
+                    expect(']');
+                }
+            }
+            else if (literal("true"))  { v.type = JsonValue::Bool; v.boolean = true; }
+            else if (literal("false")) { v.type = JsonValue::Bool; }
+            else if (literal("null"))  { }
+            else {
+                const char* begin = s.data() + pos;
+                char* end = nullptr;
+                std::string num(begin, std::min<size_t>(s.size() - pos, 32));
+                v.number = std::strtod(num.c_str(), &end);
+                if (end == num.c_str()) fail("value expected");
+                v.type = JsonValue::Number;
+                pos += end - num.c_str();
+            }
+            v.raw = std::string(s.substr(start, pos - start));
+            return v;
+        }
+    };
+
+    std::map<std::string, JsonValue> m_values;
+};
+
+#endif // NDJSON_H
@@ -0,0 +1,72 @@
+/*
+Occupancy bitboards of a grid up to 64x64 cells.
+
+For every row a 64-bit word holds one bit per column telling if that cell is
+occupied, and for every column one holds a bit per row. Both are updated with
+set() whenever a letter is written to the grid, and reset() when one is taken
+back. A placement test for a word, i.e. "the span is empty and so are the
+cells before, after and beside it", then takes a few shifts and masks on
+three words instead of a loop over the word's letters.
+
+For larger grids the bitboards are disabled (enabled() is false) and the
+callers fall back to scanning the cells.
+*/
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <cstdint>
+#include <vector>
+
+class Occupancy {
+public:
+    static constexpr int MaxSize = 64;
+
+    Occupancy(int width, int height) {
+        if (width > MaxSize || height > MaxSize) return;
+        m_rows.assign(height, 0);
+        m_cols.assign(width, 0);
+    }
+
+    bool enabled() const { return !m_cols.empty(); }
+
+    void set(int row, int col) {
+        m_rows[row] |= bit(col);
+        m_cols[col] |= bit(row);
+    }
+    void reset(int row, int col) {
+        m_rows[row] &= ~bit(col);
+        m_cols[col] &= ~bit(row);
+    }
+
+    // The row (horz) or column (vert) with index i; empty outside the grid.
+    uint64_t line(bool horz, int i) const {
+        const auto& lines = horz ? m_rows : m_cols;
+        return i >= 0 && i < int(lines.size()) ? lines[i] : 0;
+    }
+
+    static uint64_t bit(int i)
+        { return i >= 0 && i < MaxSize ? uint64_t(1) << i : 0; }
+
+    // The bits start .. start+len-1, with 0 <= start and start + len <= 64.
+    static uint64_t span(int start, int len)
+        { return (len >= MaxSize ? ~uint64_t(0) : (uint64_t(1) << len) - 1) << start; }
+
+    /* Tests the span of len cells from start on the given line:
+     * the cells before and after the span must be empty, and all cells of the
+     * span which aren't in 'filled' must be empty and have empty neighbors on
+     * both adjacent lines. Cells in 'filled' (crossings) aren't tested.
+     */
+    bool span_free(bool horz, int line, int start, int len, uint64_t filled) const {
+        uint64_t free = span(start, len) & ~filled;
+        uint64_t ends = bit(start - 1) | bit(start + len);
+        return (this->line(horz, line) & (free | ends)) == 0
+            && ((this->line(horz, line - 1) | this->line(horz, line + 1)) & free) == 0;
+    }
+
+private:
+    std::vector<uint64_t> m_rows;  // bit c of m_rows[r] is cell r,c
+    std::vector<uint64_t> m_cols;  // bit r of m_cols[c] is cell r,c
+};
+
+#endif // OCCUPANCY_H
@@ -0,0 +1,146 @@
+/*
+A cache of pattern matches (PatternIndex::Candidates, see pattern_index.h),
+shared by all threads of a long-running process, so the slot patterns which
+come up again and again (the fill's forward checking asks for the same
+partial slots throughout a search and across fills, see fill_engine.h) are
+intersected once, and a draw from them takes one random index.
+
+The cache is split into shards by the hash of the key, each with its own
+mutex, so threads only contend when they hit the same shard at the same time
+and there is no global lock. Memory is bounded: each shard holds up to its
+part of max_bytes, and evicts by CLOCK (second chance), i.e. a hit sets an
+entry's reference bit, and the clock hand clears set bits and evicts the first
+entry whose bit is clear.
+
+Entries are handed out as shared pointers, so an evicted entry stays valid
+for a thread still drawing from it.
+
+ find(key)          : the cached entry, or nullptr
+ insert(key, entry) : caches the entry and returns the cached one (another
+                      thread may have inserted the key meanwhile)
+ stats()            : hits, misses, evictions, entries and bytes so far
+*/
+
+#ifndef PATTERN_CACHE_H
+#define PATTERN_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "instrumentation.h"
+#include "pattern_index.h"
+
+class PatternCache {
+public:
+    using Entry = std::shared_ptr<const PatternIndex::Candidates>;
+    struct Stats {
+        uint64_t hits = 0, misses = 0, evictions = 0;
+        size_t entries = 0, bytes = 0;
+    };
+
+    explicit PatternCache(size_t max_bytes) : m_shard_bytes(max_bytes / ShardCount) { }
+    PatternCache(const PatternCache&) = delete;
+    PatternCache& operator=(const PatternCache&) = delete;
+
+    Entry find(const std::string& key) {
+        Shard& sh = shard(key);
+        std::lock_guard<std::mutex> lock(sh.mutex);
+        auto it = sh.index.find(key);
+        if (it == sh.index.end()) {
+            ++sh.misses;
+            CWG_COUNT(PatternCacheMisses);
+            return nullptr;
+        }
+        ++sh.hits;
+        CWG_COUNT(PatternCacheHits);
+        Slot& slot = sh.slots[it->second];
+        slot.referenced = true;
+        return slot.entry;
+    }
+
+    Entry insert(const std::string& key, Entry entry) {
+        const size_t bytes = entry->bytes() + key.size() + SlotOverhead;
+        if (bytes > m_shard_bytes) return entry;  // too large to be cached
+        Shard& sh = shard(key);
+        std::lock_guard<std::mutex> lock(sh.mutex);
+        auto it = sh.index.find(key);
+        if (it != sh.index.end()) return sh.slots[it->second].entry;
+        while (sh.bytes + bytes > m_shard_bytes) evict(sh);
+        size_t i = sh.slots.size();
+        if (!sh.free.empty()) {
+            i = sh.free.back();
+            sh.free.pop_back();
+        }
+        else sh.slots.emplace_back();
+        sh.slots[i] = Slot{ key, entry, bytes, false };
+        sh.index.emplace(key, i);
+        sh.bytes += bytes;
+        return entry;
+    }
+
+    Stats stats() const {
+        Stats s;
+        for (const Shard& sh : m_shards) {
+            std::lock_guard<std::mutex> lock(sh.mutex);
+            s.hits      += sh.hits;
+            s.misses    += sh.misses;
+            s.evictions += sh.evictions;
+            s.entries   += sh.index.size();
+            s.bytes     += sh.bytes;
+        }
+        return s;
+    }
+
+private:
+    static constexpr size_t ShardCount = 64;
+    static constexpr size_t SlotOverhead = 96;  // slot, index node, shared_ptr control block
+
+    struct Slot {
+        std::string key;
+        Entry entry;      // nullptr if the slot is free
+        size_t bytes = 0;
+        bool referenced = false;
+    };
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, size_t> index;  // key -> slot
+        std::vector<Slot> slots;                        // the clock
+        std::vector<size_t> free;                       // free slots
+        size_t hand = 0, bytes = 0;
+        uint64_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    Shard& shard(const std::string& key) { return m_shards[std::hash<std::string>()(key) % ShardCount]; }
+
+    // Advances the clock hand to the next entry without reference bit and evicts it.
+    void evict(Shard& sh) {
+        for (;; sh.hand = (sh.hand + 1) % sh.slots.size()) {
+            Slot& slot = sh.slots[sh.hand];
+            if (!slot.entry) continue;
+            if (slot.referenced) {
+                slot.referenced = false;
+                continue;
+            }
+            sh.index.erase(slot.key);
+            sh.bytes -= slot.bytes;
+            slot = Slot();
+            sh.free.push_back(sh.hand);
+            ++sh.evictions;
+            CWG_COUNT(PatternCacheEvictions);
+            return;
+        }
+    }
+
+    const size_t m_shard_bytes;
+    std::array<Shard, ShardCount> m_shards;
+};
+
+#endif // PATTERN_CACHE_H
@@ -0,0 +1,349 @@
+/*
+Inverted index over a word list, keyed by (word length, letter position, letter).
+
+The words of each length form a bucket. For every position and letter a bucket
+keeps a bitset telling which of its words have that letter at that position.
+A pattern like "?A??E" is resolved by AND-ing the bitsets of its fixed letters
+(see bitset_kernels.h), so only words which really fit a slot are ever looked
+at. Any character which isn't a letter (e.g. '?' or the grid's '.') is a
+wildcard.
+
+Words are referred to by the ids the index was built with, so the caller keeps
+owning the words as such.
+
+With word weights, pick() draws a word with probability proportional to its
+weight among the matches. Each bucket then keeps its words grouped by weight
+class (weights within [2^(k-1), 2^k)), so the matches of a class are a range
+of the bitset: a draw counts the matches per class in one pass, picks a class
+by count times class bound, a match within it uniformly, and keeps it with
+probability weight / class bound, which is at least 1/2. So a draw takes less
+than two tries on average, however skewed the weights are.
+
+The matches of a pattern can also be listed as Candidates, which PatternCache
+(see pattern_cache.h) keeps across draws: a draw from them takes one random
+index instead of intersecting, counting and selecting, and draws the same
+word as pick() from the same engine state.
+*/
+
+#ifndef PATTERN_INDEX_H
+#define PATTERN_INDEX_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "bitset_kernels.h"
+#include "rng.h"
+
+class PatternIndex {
+public:
+    static constexpr int AlphabetSize = 26;
+    static constexpr size_t MaxLength = 64;  // longer words aren't indexed
+
+    /* Indexes the words 0 .. count-1, word_at(id) must return the word as
+     * string_view, weight_at(id) (if given) its weight. Words with
+     * non-alphabetic characters or without a positive weight are left out.
+     */
+    template <class WordAt, class WeightAt = std::nullptr_t>
+    PatternIndex(uint32_t count, WordAt word_at, WeightAt weight_at = nullptr) {
+        constexpr bool weighted = !std::is_same_v<WeightAt, std::nullptr_t>;
+        for (uint32_t id = 0; id < count; ++id) {
+            std::string_view word = word_at(id);
+            if (!alphabetic(word) || word.size() > MaxLength) continue;
+            if constexpr (weighted)
+                if (!(weight_at(id) > 0)) continue;  // never drawn anyway
+            if (word.size() >= m_buckets.size()) m_buckets.resize(word.size() + 1);
+            m_buckets[word.size()].ids.push_back(id);
+        }
+        for (size_t len = 1; len < m_buckets.size(); ++len) {
+            auto& b = m_buckets[len];
+            if constexpr (weighted) group_by_weight(b, weight_at);
+            b.blocks = (b.ids.size() + 63) / 64;
+            b.bits.assign((len * AlphabetSize + 1) * b.blocks, 0);
+            for (size_t i = 0; i < b.ids.size(); ++i)
+                b.bits[len * AlphabetSize * b.blocks + i / 64] |= uint64_t(1) << (i % 64);
+            for (size_t i = 0; i < b.ids.size(); ++i) {
+                std::string_view word = word_at(b.ids[i]);
+                for (size_t pos = 0; pos < len; ++pos) {
+                    int letter = std::toupper(word[pos]) - 'A';
+                    b.bits[(pos * AlphabetSize + letter) * b.blocks + i / 64]
+                        |= uint64_t(1) << (i % 64);
+                }
+            }
+        }
+    }
+
+    // Number of indexed words with the given length.
+    size_t size(size_t length) const
+        { return length < m_buckets.size() ? m_buckets[length].ids.size() : 0; }
+
+    /* Appends the ids of all words matching 'pattern' to 'ids'.
+     * Returns the number of appended ids.
+     */
+    size_t match(std::string_view pattern, std::vector<uint32_t>& ids) const {
+        const uint64_t* bits;
+        const Bucket* b = intersect(pattern, bits);
+        if (!b) return 0;
+        size_t found = 0;
+        for (size_t block = 0; block < b->blocks; ++block)
+            for (uint64_t w = bits[block]; w; w &= w - 1, ++found)
+                ids.push_back(b->ids[block * 64 + __builtin_ctzll(w)]);
+        return found;
+    }
+
+    // True if some word matches 'pattern'; stops at the first block with a match.
+    bool any(std::string_view pattern) const {
+        const uint64_t* keys[MaxLength];
+        size_t nkeys;
+        const Bucket* b = fixed_keys(pattern, keys, nkeys);
+        if (!b) return false;
+        for (size_t block = 0; block < b->blocks; ++block) {
+            uint64_t w = keys[0][block];
+            for (size_t k = 1; k < nkeys && w; ++k) w &= keys[k][block];
+            if (w) return true;
+        }
+        return false;
+    }
+
+    // Number of words matching 'pattern'.
+    size_t count(std::string_view pattern) const {
+        const uint64_t* bits;
+        const Bucket* b = intersect(pattern, bits);
+        return b ? bitset_popcount(bits, b->blocks) : 0;
+    }
+
+    /* Draws a random word matching 'pattern' into 'id', uniformly or, with
+     * weights, proportional to them. Returns false if no word matches.
+     */
+    template <class Rng>
+    bool pick(std::string_view pattern, Rng& rng, uint32_t& id) const {
+        const uint64_t* bits;
+        const Bucket* b = intersect(pattern, bits);
+        if (!b) return false;
+        if (!b->classes.empty()) return pick_weighted(*b, bits, rng, id);
+        size_t found = bitset_popcount(bits, b->blocks);
+        if (found == 0) return false;
+        size_t n = random_below(rng, found);
+        id = b->ids[bitset_select(bits, b->blocks, n)];
+        return true;
+    }
+
+    // The matches of a pattern, see above.
+    struct Candidates {
+        size_t length = 0;
+        std::vector<uint32_t> entries;    // bucket entries, in bucket order
+        std::vector<uint32_t> class_end;  // with weights: end of each class in entries
+        double mass = 0;                  // with weights: sum of count times class bound
+
+        size_t bytes() const
+            { return sizeof(*this) + 4 * (entries.capacity() + class_end.capacity()); }
+    };
+
+    /* The key of a pattern in a PatternCache: uppercase letters, '?' for
+     * wildcards, so patterns which match the same words have the same key.
+     */
+    static std::string key(std::string_view pattern) {
+        std::string key(pattern);
+        for (char& ch : key)
+            ch = std::isalpha(static_cast<unsigned char>(ch))
+               ? std::toupper(static_cast<unsigned char>(ch)) : '?';
+        return key;
+    }
+
+    Candidates candidates(std::string_view pattern) const {
+        Candidates c;
+        c.length = pattern.size();
+        const uint64_t* bits;
+        const Bucket* b = intersect(pattern, bits);
+        if (!b) return c;
+        c.entries.reserve(bitset_popcount(bits, b->blocks));
+        for (size_t block = 0; block < b->blocks; ++block)
+            for (uint64_t w = bits[block]; w; w &= w - 1)
+                c.entries.push_back(block * 64 + __builtin_ctzll(w));
+        size_t i = 0;
+        for (const auto& cls : b->classes) {
+            size_t first = i;
+            while (i < c.entries.size() && c.entries[i] < cls.last) ++i;
+            c.class_end.push_back(i);
+            c.mass += double(i - first) * cls.bound;
+        }
+        return c;
+    }
+
+    // As match() and pick() above, from the candidates of a pattern.
+    size_t match(const Candidates& c, std::vector<uint32_t>& ids) const {
+        for (uint32_t i : c.entries) ids.push_back(m_buckets[c.length].ids[i]);
+        return c.entries.size();
+    }
+
+    template <class Rng>
+    bool pick(const Candidates& c, Rng& rng, uint32_t& id) const {
+        if (c.entries.empty()) return false;
+        const Bucket& b = m_buckets[c.length];
+        if (b.classes.empty()) {
+            id = b.ids[c.entries[random_below(rng, c.entries.size())]];
+            return true;
+        }
+        for (;;) {
+            double u = random_real(rng, 0, c.mass);
+            size_t k = 0, first = 0;
+            for (; k + 1 < b.classes.size()
+                   && u >= (c.class_end[k] - first) * double(b.classes[k].bound); ++k) {
+                u -= (c.class_end[k] - first) * double(b.classes[k].bound);
+                first = c.class_end[k];
+            }
+            size_t count = c.class_end[k] - first;
+            if (count == 0) continue;  // rounding at the very end
+            size_t i = c.entries[first + random_below(rng, count)];
+            if (random_real(rng, 0, b.classes[k].bound) < b.weights[i]) {
+                id = b.ids[i];
+                return true;
+            }
+        }
+    }
+
+private:
+    struct Bucket {
+        std::vector<uint32_t> ids;   // word id of each bucket entry
+        size_t blocks = 0;           // 64-bit blocks per bitset
+        std::vector<uint64_t> bits;  // bitsets, ordered by position, then letter,
+                                     // followed by the bitset of all words
+        const uint64_t* key(size_t pos, int letter) const
+            { return &bits[(pos * AlphabetSize + letter) * blocks]; }
+        const uint64_t* all() const { return &bits[bits.size() - blocks]; }
+
+        // with weights only:
+        std::vector<float> weights;  // of each bucket entry
+        struct Class {
+            uint32_t first, last;    // bucket entries
+            float bound;             // above all weights of the class
+        };
+        std::vector<Class> classes;  // by descending bound
+    };
+    static constexpr size_t MaxClasses = 300;  // exponents of positive floats
+
+    // Sorts the bucket's entries by weight class, see above.
+    template <class WeightAt>
+    static void group_by_weight(Bucket& b, WeightAt weight_at) {
+        auto exponent = [&](uint32_t id) {
+            int e;
+            std::frexp(weight_at(id), &e);
+            return e;
+        };
+        std::stable_sort(b.ids.begin(), b.ids.end(),
+            [&](uint32_t x, uint32_t y) { return exponent(x) > exponent(y); });
+        for (uint32_t i = 0; i < b.ids.size(); ++i) {
+            b.weights.push_back(weight_at(b.ids[i]));
+            int e = exponent(b.ids[i]);
+            if (b.classes.empty() || std::ldexp(1.0f, e) != b.classes.back().bound)
+                b.classes.push_back({ i, i, std::ldexp(1.0f, e) });
+            b.classes.back().last = i + 1;
+        }
+    }
+
+    // Number of set bits within the bit range [first, last).
+    static size_t popcount_range(const uint64_t* bits, size_t first, size_t last) {
+        size_t count = 0;
+        for (size_t block = first / 64; block * 64 < last; ++block) {
+            uint64_t w = bits[block];
+            if (block == first / 64) w &= ~uint64_t(0) << (first % 64);
+            if ((block + 1) * 64 > last) w &= ~uint64_t(0) >> (64 - last % 64);
+            count += __builtin_popcountll(w);
+        }
+        return count;
+    }
+
+    template <class Rng>
+    static bool pick_weighted(const Bucket& b, const uint64_t* bits, Rng& rng, uint32_t& id) {
+        size_t counts[MaxClasses];
+        double mass = 0;
+        size_t found = 0;
+        for (size_t c = 0; c < b.classes.size(); ++c) {
+            counts[c] = popcount_range(bits, b.classes[c].first, b.classes[c].last);
+            mass += double(counts[c]) * b.classes[c].bound;
+            found += counts[c];
+        }
+        if (found == 0) return false;
+        for (;;) {
+            double u = random_real(rng, 0, mass);
+            size_t c = 0, rank = 0;
+            for (; c + 1 < b.classes.size() && u >= counts[c] * double(b.classes[c].bound); ++c) {
+                u -= counts[c] * double(b.classes[c].bound);
+                rank += counts[c];
+            }
+            if (counts[c] == 0) continue;  // rounding at the very end
+            rank += random_below(rng, counts[c]);
+            size_t i = bitset_select(bits, b.blocks, rank);
+            if (random_real(rng, 0, b.classes[c].bound) < b.weights[i]) {
+                id = b.ids[i];
+                return true;
+            }
+        }
+    }
+
+    static bool alphabetic(std::string_view word) {
+        if (word.empty()) return false;
+        for (char ch : word)
+            if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
+        return true;
+    }
+
+    // Per thread buffer for the result of intersect().
+    static std::vector<uint64_t>& scratch() {
+        thread_local std::vector<uint64_t> bits;
+        return bits;
+    }
+
+    /* Collects the bitsets of the pattern's fixed letters into 'keys' (at
+     * least one: without fixed letters that of all words). Returns the
+     * pattern's bucket, or nullptr if there is none.
+     */
+    const Bucket* fixed_keys(std::string_view pattern, const uint64_t** keys,
+                             size_t& nkeys) const {
+        if (pattern.size() >= m_buckets.size() || pattern.size() > MaxLength) return nullptr;
+        const Bucket& b = m_buckets[pattern.size()];
+        if (b.ids.empty()) return nullptr;
+        nkeys = 0;
+        for (size_t pos = 0; pos < pattern.size(); ++pos) {
+            unsigned char ch = pattern[pos];
+            if (std::isalpha(ch))
+                keys[nkeys++] = b.key(pos, std::toupper(ch) - 'A');
+        }
+        if (nkeys == 0) keys[nkeys++] = b.all();
+        return &b;
+    }
+
+    /* Intersects the bitsets of the pattern's fixed letters into scratch(),
+     * and points 'bits' to the result; with a single fixed letter (or none)
+     * that's the key itself, nothing is copied. Returns the pattern's bucket,
+     * or nullptr if there is none.
+     */
+    const Bucket* intersect(std::string_view pattern, const uint64_t*& bits) const {
+        const uint64_t* keys[MaxLength];
+        size_t nkeys;
+        const Bucket* found = fixed_keys(pattern, keys, nkeys);
+        if (!found) return nullptr;
+        const Bucket& b = *found;
+        if (nkeys == 1) {
+            bits = keys[0];
+            return &b;
+        }
+
+        auto& result = scratch();
+        if (result.size() < b.blocks) result.resize(b.blocks);
+        bitset_and(result.data(), keys, nkeys, b.blocks);
+        bits = result.data();
+        return &b;
+    }
+
+    std::vector<Bucket> m_buckets;  // indexed by word length
+};
+
+#endif // PATTERN_INDEX_H
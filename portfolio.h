@@ -0,0 +1,179 @@
+/*
+Portfolio generation: the best of as many runs as fit into a time budget.
+
+The quality of a puzzle varies a lot from run to run, since every run is
+driven by its seed and greedy choices. A Portfolio spends idle cores on that:
+its workers run generations one after another, run k with generator
+k % generators.size() and puzzle_rng(seed, k), until the budget is spent, and
+the densest puzzle (most letter cells) is kept.
+
+ - The best score is published through one atomic word (score and run
+   number), so a worker only copies a puzzle which beats it and never waits
+   for another worker. Each worker keeps its own best puzzle; they are
+   compared once at the end.
+ - At the deadline all runs in flight are cancelled (see Cancel in
+   generator.h). The letters table and weight approaches leave their grid
+   so far, which competes as a partial result; so does run 0, which is
+   started even if the workers got to the portfolio after the deadline (e.g.
+   on a pool busy with other portfolios), so there is a result at all.
+   All runs are cancelled as well as soon as a run fills every open cell,
+   which nothing can beat.
+ - The letters of the best puzzle so far are passed to the runs as
+   GeneratorParams::beat: a run gives up as soon as its bound (its letters
+   plus what it could still add) can't beat them.
+
+The result names the generator and run, so the winning puzzle can be
+reproduced with puzzle_rng(seed, run) alone, unless it is partial.
+
+Call work() on as many threads as should take part (e.g. as jobs of a
+WorkStealingPool, see generate_portfolio()), then result().
+*/
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "generator.h"
+#include "work_stealing_pool.h"
+
+struct PortfolioResult {
+    Puzzle puzzle;
+    const char* generator = nullptr;  // which found the puzzle
+    uint64_t run = 0;                 // and with puzzle_rng(seed, run)
+    uint64_t runs = 0;                // runs finished within the budget
+    bool partial = false;             // cut off by the deadline
+};
+
+class Portfolio {
+public:
+    Portfolio(std::vector<const Generator*> generators, const GeneratorParams& params,
+              uint64_t seed, Cancel::Clock::duration budget)
+        : m_generators(std::move(generators)), m_params(params), m_seed(seed),
+          m_cancel(Cancel::Clock::now() + budget) {
+        if (m_generators.empty()) throw std::invalid_argument("No generators for the portfolio");
+        m_params.cancel = &m_cancel;
+        m_params.beat = &m_bar;
+        if (m_params.layout.empty())
+            m_open = m_params.width * m_params.height;
+        else
+            for (const auto& row : m_params.layout)
+                m_open += row.size() - std::count(row.begin(), row.end(), Puzzle::Black);
+    }
+    Portfolio(const Portfolio&) = delete;
+    Portfolio& operator=(const Portfolio&) = delete;
+
+    // Runs generations until the budget is spent.
+    void work() {
+        Best best;
+        try {
+            run_until_stopped(best);
+        }
+        catch (...) {
+            m_cancel.stop();  // the parameters won't do for the others either
+            throw;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (best.generator) m_bests.push_back(std::move(best));
+    }
+
+    // Ends the runs early.
+    void stop() { m_cancel.stop(); }
+
+    /* The best puzzle, once all work() calls have returned. False only if
+     * no run finished within the budget and none left a grid so far.
+     */
+    bool result(PortfolioResult& result) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.runs = m_runs.load();
+        const uint64_t top = m_best.load();
+        for (auto& best : m_bests)
+            if (best.key == top) {
+                result.puzzle = std::move(best.puzzle);
+                result.generator = best.generator;
+                result.run = best.run;
+                result.partial = best.partial;
+                return true;
+            }
+        return false;
+    }
+
+private:
+    struct Best {
+        Puzzle puzzle;
+        const char* generator = nullptr;
+        uint64_t run = 0, key = 0;
+        bool partial = false;
+    };
+
+    void run_until_stopped(Best& best) {
+        for (;;) {
+            const uint64_t run = m_next.fetch_add(1, std::memory_order_relaxed);
+            if (run > 0 && m_cancel.stopped()) return;
+            const Generator& generator = *m_generators[run % m_generators.size()];
+            auto rng = puzzle_rng(m_seed, run);
+            Puzzle puzzle;
+            const bool done = generator.generate(m_params, rng, puzzle);
+            if (done) m_runs.fetch_add(1, std::memory_order_relaxed);
+            else if (puzzle.width() == 0) continue;  // failed, or cancelled without a grid
+
+            const int letters = puzzle.letters();
+            const uint64_t k = key(letters, run);
+            if (!publish(k)) continue;
+            raise_bar(letters);
+            best = Best{ std::move(puzzle), generator.name(), run, k, !done };
+            if (letters >= m_open) m_cancel.stop();
+        }
+    }
+
+    // Higher is better: more letters, then the earlier run.
+    static uint64_t key(int letters, uint64_t run)
+        { return uint64_t(letters) << 32 | (UINT32_MAX - std::min<uint64_t>(run, UINT32_MAX)); }
+
+    // Makes 'k' the best key if it is; false if another one is better.
+    bool publish(uint64_t k) {
+        uint64_t top = m_best.load(std::memory_order_relaxed);
+        while (k > top)
+            if (m_best.compare_exchange_weak(top, k, std::memory_order_relaxed)) return true;
+        return false;
+    }
+
+    // Makes 'letters' the bar if it is higher.
+    void raise_bar(int letters) {
+        int bar = m_bar.load(std::memory_order_relaxed);
+        while (letters > bar)
+            if (m_bar.compare_exchange_weak(bar, letters, std::memory_order_relaxed)) return;
+    }
+
+    std::vector<const Generator*> m_generators;
+    GeneratorParams m_params;            // with m_cancel and m_bar
+    uint64_t m_seed;
+    Cancel m_cancel;
+    int m_open = 0;                      // open cells, the best possible score
+    std::atomic<uint64_t> m_next{0};     // the next run
+    std::atomic<uint64_t> m_runs{0};
+    std::atomic<uint64_t> m_best{0};     // key() of the best puzzle so far
+    std::atomic<int> m_bar{-1};          // its letters
+    std::mutex m_mutex;
+    std::vector<Best> m_bests;           // the best puzzle of each worker
+};
+
+// Runs a portfolio on 'threads' threads and returns its best puzzle in 'result'.
+inline bool generate_portfolio(std::vector<const Generator*> generators,
+        const GeneratorParams& params, uint64_t seed, Cancel::Clock::duration budget,
+        unsigned threads, PortfolioResult& result) {
+    Portfolio portfolio(std::move(generators), params, seed, budget);
+    WorkStealingPool pool(std::max(threads, 1u));
+    for (unsigned i = 0; i < pool.size(); ++i)
+        pool.submit([&portfolio] { portfolio.work(); });
+    pool.wait();
+    return portfolio.result(result);
+}
+
+#endif // PORTFOLIO_H
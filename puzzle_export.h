@@ -0,0 +1,255 @@
+/*
+Bulk output of puzzles: a PuzzleWriter serializes puzzles into a large
+buffer, and a background thread writes full buffers to a file descriptor with
+plain write() calls. The thread adding puzzles only waits if both buffers are
+full, i.e. if output is slower than generation on the whole.
+
+Formats:
+
+ text   : Puzzle::print() layout, puzzles separated by an empty line
+ ndjson : one JSON object per puzzle and line:
+          {"seed":S,"n":N,"width":W,"height":H,"letters":L,"density":D,
+           "rows":["ROW",...],"words":[[row,col,"across"|"down","WORD"],...]}
+ binary : a file header (magic "CWGP", uint32 version), then per puzzle
+            uint32 size        of the record, this field excluded
+            uint64 seed, n
+            uint16 width, height
+            uint32 letters     letter cells
+            uint32 words
+            width * height     cells, row-major, as in Puzzle
+            per word: uint16 row, col; uint8 across (1) or down (0), length;
+                      the letters
+          all integers little-endian
+
+Seed and n are those of puzzle_rng(seed, n), so every puzzle of a batch can
+be generated again on its own. A word is every run of two or more letters
+(the generators keep words apart).
+*/
+
+#ifndef PUZZLE_EXPORT_H
+#define PUZZLE_EXPORT_H
+
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "generator.h"
+#include "ndjson.h"
+
+constexpr char     PuzzleExportMagic[4]  = { 'C', 'W', 'G', 'P' };
+constexpr uint32_t PuzzleExportVersion   = 1;
+
+struct PlacedWord {
+    int row, col;
+    bool across;
+    std::string word;
+};
+
+// The words of a puzzle, across ones first.
+inline std::vector<PlacedWord> puzzle_words(const Puzzle& puzzle) {
+    std::vector<PlacedWord> words;
+    const int height = puzzle.height(), width = puzzle.width();
+    auto letter = [&](int r, int c) { return std::isalpha((unsigned char)puzzle[r][c]) != 0; };
+    for (int horz = 1; horz >= 0; --horz)
+        for (int line = 0; line < (horz ? height : width); ++line)
+            for (int i = 0, cells = horz ? width : height; i < cells; ) {
+                int start = i;
+                std::string word;
+                for (; i < cells && (horz ? letter(line, i) : letter(i, line)); ++i)
+                    word += horz ? puzzle[line][i] : puzzle[i][line];
+                if (word.size() >= 2)
+                    words.push_back(PlacedWord{ horz ? line : start, horz ? start : line,
+                                                bool(horz), std::move(word) });
+                if (i == start) ++i;
+            }
+    return words;
+}
+
+class PuzzleWriter {
+public:
+    enum Format { Text, Ndjson, Binary };
+
+    // Throws std::invalid_argument for an unknown name.
+    static Format format(const std::string& name) {
+        if (name == "text")   return Text;
+        if (name == "ndjson") return Ndjson;
+        if (name == "binary") return Binary;
+        throw std::invalid_argument("Unknown output format " + name);
+    }
+
+    /* Writes to 'fd', which stays open. A buffer is handed to the writer
+     * thread once it holds 'buffer_size' bytes.
+     */
+    PuzzleWriter(int fd, Format format, size_t buffer_size = 1 << 20)
+        : m_fd(fd), m_format(format), m_buffer_size(buffer_size) {
+        m_buffer.reserve(m_buffer_size + (m_buffer_size >> 2));
+        m_pending.reserve(m_buffer.capacity());
+        if (m_format == Binary) {
+            m_buffer.append(PuzzleExportMagic, sizeof(PuzzleExportMagic));
+            put(m_buffer, PuzzleExportVersion, 4);
+        }
+        m_thread = std::thread([this] { run(); });
+    }
+    PuzzleWriter(const PuzzleWriter&) = delete;
+    PuzzleWriter& operator=(const PuzzleWriter&) = delete;
+
+    // Writes what is left; errors are lost here, call flush() to see them.
+    ~PuzzleWriter() {
+        try { flush(); } catch (...) { }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    // Adds the puzzle generated with puzzle_rng(seed, n).
+    void add(const Puzzle& puzzle, uint64_t seed, uint64_t n) {
+        switch (m_format) {
+        case Text:
+            if (m_count) m_buffer += '\n';
+            text(m_buffer, puzzle);
+            break;
+        case Ndjson: ndjson(m_buffer, puzzle, seed, n); break;
+        case Binary: binary(m_buffer, puzzle, seed, n); break;
+        }
+        ++m_count;
+        if (m_buffer.size() >= m_buffer_size) hand_off();
+    }
+
+    /* Waits until everything added so far is written.
+     * Throws std::runtime_error if a write failed.
+     */
+    void flush() {
+        hand_off();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return !m_busy; });
+        if (m_error) throw std::runtime_error(std::string("Write failed: ")
+                                              + std::strerror(m_error));
+    }
+
+    size_t count() const { return m_count; }
+
+    // The single records, appended to 'out'.
+    static void text(std::string& out, const Puzzle& puzzle) { puzzle.append_text(out); }
+
+    static void ndjson(std::string& out, const Puzzle& puzzle, uint64_t seed, uint64_t n) {
+        const auto words = puzzle_words(puzzle);
+        char density[32];
+        std::snprintf(density, sizeof(density), "%.4f", puzzle.density());
+        out += "{\"seed\":" + std::to_string(seed) + ",\"n\":" + std::to_string(n)
+             + ",\"width\":" + std::to_string(puzzle.width())
+             + ",\"height\":" + std::to_string(puzzle.height())
+             + ",\"letters\":" + std::to_string(puzzle.letters())
+             + ",\"density\":" + density + ",\"rows\":[";
+        for (int r = 0; r < puzzle.height(); ++r) {
+            if (r) out += ',';
+            json_string(out, std::string_view(puzzle[r], puzzle.width()));
+        }
+        out += "],\"words\":[";
+        for (size_t i = 0; i < words.size(); ++i) {
+            const auto& w = words[i];
+            if (i) out += ',';
+            out += '[' + std::to_string(w.row) + ',' + std::to_string(w.col)
+                 + (w.across ? ",\"across\"," : ",\"down\",");
+            json_string(out, w.word);
+            out += ']';
+        }
+        out += "]}\n";
+    }
+
+    static void binary(std::string& out, const Puzzle& puzzle, uint64_t seed, uint64_t n) {
+        const auto words = puzzle_words(puzzle);
+        const size_t start = out.size();
+        put(out, 0, 4);  // size, see below
+        put(out, seed, 8);
+        put(out, n, 8);
+        put(out, puzzle.width(), 2);
+        put(out, puzzle.height(), 2);
+        put(out, puzzle.letters(), 4);
+        put(out, words.size(), 4);
+        for (int r = 0; r < puzzle.height(); ++r) out.append(puzzle[r], puzzle.width());
+        for (const auto& w : words) {
+            put(out, w.row, 2);
+            put(out, w.col, 2);
+            put(out, w.across, 1);
+            put(out, w.word.size(), 1);
+            out += w.word;
+        }
+        const uint64_t size = out.size() - start - 4;
+        for (int i = 0; i < 4; ++i) out[start + i] = char(size >> (8 * i));
+    }
+
+private:
+    // Appends the low 'bytes' bytes of 'value', little-endian.
+    static void put(std::string& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) out += char(value >> (8 * i));
+    }
+
+    // Passes the buffer to the writer thread, once it is done with the previous one.
+    void hand_off() {
+        if (m_buffer.empty()) return;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_busy; });
+            m_pending.swap(m_buffer);
+            m_busy = true;
+        }
+        m_cv.notify_all();
+        m_buffer.clear();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_cv.wait(lock, [this] { return m_busy || m_done; });
+            if (!m_busy) return;
+            lock.unlock();
+            int error = write_all(m_pending);
+            m_pending.clear();
+            lock.lock();
+            if (error && !m_error) m_error = error;
+            m_busy = false;
+            m_cv.notify_all();
+        }
+    }
+
+    // Returns 0 or the errno of the failed write().
+    int write_all(const std::string& data) const {
+        for (size_t done = 0; done < data.size(); ) {
+            ssize_t n = ::write(m_fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return errno;
+            }
+            done += n;
+        }
+        return 0;
+    }
+
+    const int m_fd;
+    const Format m_format;
+    const size_t m_buffer_size;
+    std::string m_buffer;   // being filled by add()
+    std::string m_pending;  // being written by m_thread while m_busy
+    size_t m_count = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_busy = false, m_done = false;
+    int m_error = 0;
+    std::thread m_thread;
+};
+
+#endif // PUZZLE_EXPORT_H
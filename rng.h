@@ -0,0 +1,98 @@
+/*
+The random engine of the generators, and the draws they make with it.
+
+CounterRng is SplitMix64 used as counter-based generator: draw i of a stream
+is mix(key + i * Gamma), where mix is a bijective 64-bit finalizer and the
+key is derived from (seed, stream). So a stream is a pure function of its
+seed and index, the state is two words, and the engine behaves the same on
+every platform (unlike std::default_random_engine). See puzzle_rng() in
+generator.h for the stream of a puzzle.
+
+ random_below(rng, n)         : uniform in [0, n), unbiased (Lemire's
+                                multiply-and-reject, one multiplication and
+                                hardly ever a division or a second draw)
+ random_between(rng, lo, hi)  : uniform in [lo, hi]
+ random_real(rng, lo, hi)     : uniform in [lo, hi)
+ random_order(first, last, rng)
+
+These take any standard random bit generator; with a full 64-bit one like
+CounterRng they do without the std distributions, which cost a construction
+and a division (or more) per draw.
+*/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <utility>
+
+class CounterRng {
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    explicit CounterRng(uint64_t seed = 0, uint64_t stream = 0)
+        : m_key(mix(seed ^ mix(stream + Gamma))) { }
+
+    result_type operator()() { return mix(m_key + ++m_counter * Gamma); }
+    void discard(uint64_t n) { m_counter += n; }
+
+    static constexpr uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static constexpr uint64_t Gamma = 0x9e3779b97f4a7c15u;  // 2^64 / golden ratio, odd
+
+    uint64_t m_key;
+    uint64_t m_counter = 0;
+};
+
+template <class Rng>
+constexpr bool full_64_bit_rng = Rng::min() == 0 && Rng::max() == ~uint64_t(0);
+
+// Uniform in [0, n), n > 0.
+template <class Rng>
+uint64_t random_below(Rng& rng, uint64_t n) {
+    if constexpr (full_64_bit_rng<Rng>) {
+        unsigned __int128 m = (unsigned __int128)rng() * n;
+        if (uint64_t(m) < n) {
+            const uint64_t threshold = -n % n;  // 2^64 mod n
+            while (uint64_t(m) < threshold) m = (unsigned __int128)rng() * n;
+        }
+        return uint64_t(m >> 64);
+    }
+    else return std::uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+}
+
+// Uniform in [lo, hi], lo <= hi.
+template <class Rng>
+int random_between(Rng& rng, int lo, int hi) {
+    return lo + int(random_below(rng, uint64_t(int64_t(hi) - lo) + 1));
+}
+
+// Uniform in [lo, hi), lo < hi.
+template <class Rng>
+double random_real(Rng& rng, double lo, double hi) {
+    if constexpr (full_64_bit_rng<Rng>) {
+        double u = (rng() >> 11) * 0x1p-53;  // [0, 1) in steps of 2^-53
+        double x = lo + u * (hi - lo);
+        return x < hi ? x : std::nextafter(hi, lo);  // rounding
+    }
+    else return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+// Puts the range into random order (Fisher-Yates, as std::shuffle), with random_below().
+template <class RandomIt, class Rng>
+void random_order(RandomIt first, RandomIt last, Rng& rng) {
+    for (auto n = std::distance(first, last); n > 1; --n)
+        std::swap(first[n - 1], first[random_below(rng, n)]);
+}
+
+#endif // RNG_H
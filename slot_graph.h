@@ -0,0 +1,123 @@
+/*
+Slot table and crossing graph of a grid template (see fill_engine.h).
+
+A template is a grid of black squares ('#') and open cells (anything else).
+Every horizontal and vertical run of at least two open cells is a slot; the
+slots are numbered across first (row by row), then down (column by column).
+
+The analysis runs once per template, after that the layout is static:
+
+ slot(s)       : row, col, length and direction of slot s
+ crossings(s)  : the slots crossing s, by position within s, each with the
+                 position within the crossing slot
+ across(cell), down(cell) : the slot through a cell (row * width + col), or -1
+
+The crossings of all slots are kept in one array, those of slot s in
+[first[s], first[s+1]) (compressed sparse rows), so walking the neighbors of
+a slot is a linear scan without pointer chasing.
+*/
+
+#ifndef SLOT_GRAPH_H
+#define SLOT_GRAPH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class SlotGraph {
+public:
+    static constexpr char Black = '#';
+
+    struct Slot {
+        int row, col, len;
+        bool horz;
+    };
+    struct Crossing {
+        int pos;         // position within this slot
+        int slot;        // the crossing slot
+        int other_pos;   // position within the crossing slot
+    };
+
+    // A range of the crossing array.
+    class Crossings {
+    public:
+        Crossings(const Crossing* first, const Crossing* last) : m_first(first), m_last(last) { }
+        const Crossing* begin() const { return m_first; }
+        const Crossing* end() const { return m_last; }
+        size_t size() const { return m_last - m_first; }
+    private:
+        const Crossing* m_first;
+        const Crossing* m_last;
+    };
+
+    // The template rows must have equal length.
+    explicit SlotGraph(const std::vector<std::string>& rows)
+        : m_width(rows.empty() ? 0 : rows[0].size()), m_height(rows.size()),
+          m_across(size_t(m_width) * m_height, -1), m_down(size_t(m_width) * m_height, -1) {
+        find_slots(rows);
+        link();
+    }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t size() const { return m_slots.size(); }
+    const Slot& slot(int s) const { return m_slots[s]; }
+    Crossings crossings(int s) const
+        { return Crossings(m_crossings.data() + m_first[s], m_crossings.data() + m_first[s + 1]); }
+    int across(size_t cell) const { return m_across[cell]; }
+    int down(size_t cell) const { return m_down[cell]; }
+
+private:
+    void find_slots(const std::vector<std::string>& rows) {
+        for (int horz = 1; horz >= 0; --horz) {
+            const int lines = horz ? m_height : m_width, cells = horz ? m_width : m_height;
+            auto& through = horz ? m_across : m_down;
+            for (int line = 0; line < lines; ++line)
+                for (int i = 0; i < cells; ) {
+                    auto open = [&](int k) { return (horz ? rows[line][k] : rows[k][line]) != Black; };
+                    if (!open(i)) { ++i; continue; }
+                    int start = i;
+                    while (i < cells && open(i)) ++i;
+                    if (i - start < 2) continue;
+                    for (int k = start; k < i; ++k)
+                        through[horz ? line * m_width + k : k * m_width + line] = m_slots.size();
+                    m_slots.push_back(Slot{ horz ? line : start, horz ? start : line, i - start,
+                                            bool(horz) });
+                }
+        }
+    }
+
+    // Builds the crossing array: counts per slot, then fills in position order.
+    void link() {
+        m_first.assign(m_slots.size() + 1, 0);
+        for (size_t cell = 0; cell < m_across.size(); ++cell)
+            if (m_across[cell] >= 0 && m_down[cell] >= 0) {
+                ++m_first[m_across[cell] + 1];
+                ++m_first[m_down[cell] + 1];
+            }
+        for (size_t s = 0; s < m_slots.size(); ++s) m_first[s + 1] += m_first[s];
+        m_crossings.resize(m_first.back());
+
+        std::vector<size_t> next(m_first.begin(), m_first.end() - 1);
+        for (int s = 0; s < int(m_slots.size()); ++s) {
+            const Slot& slot = m_slots[s];
+            for (int i = 0; i < slot.len; ++i) {
+                size_t cell = slot.horz ? size_t(slot.row) * m_width + slot.col + i
+                                        : size_t(slot.row + i) * m_width + slot.col;
+                int other = slot.horz ? m_down[cell] : m_across[cell];
+                if (other < 0) continue;
+                const Slot& o = m_slots[other];
+                m_crossings[next[s]++] = Crossing{ i, other, slot.horz ? slot.row - o.row
+                                                                       : slot.col - o.col };
+            }
+        }
+    }
+
+    int m_width, m_height;
+    std::vector<Slot> m_slots;
+    std::vector<size_t> m_first;         // crossings of slot s: [m_first[s], m_first[s+1])
+    std::vector<Crossing> m_crossings;
+    std::vector<int> m_across, m_down;   // slot through each cell, or -1
+};
+
+#endif // SLOT_GRAPH_H
@@ -0,0 +1,95 @@
+/*
+A sparse grid of 64x64 tiles, the board of the tiled generator (see
+tiled_generator.h) for large boards (1000x1000 and beyond, e.g. word-search
+posters).
+
+A tile is allocated on its first letter, an empty tile costs one null pointer
+in the tile map, so memory grows with the occupied area, not the board's. The
+4 KB of a tile fit the L1 cache, so work on one tile (a region) doesn't
+stride through the rows of the whole board.
+
+Distinct tiles may be written by distinct threads at the same time: the tile
+map is sized once, writing a tile only touches its own entry.
+*/
+
+#ifndef TILED_GRID_H
+#define TILED_GRID_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "generator.h"
+
+class TiledGrid {
+public:
+    static constexpr char Empty = '.';
+    static constexpr int TileBits = 6, TileSize = 1 << TileBits;
+    using Tile = std::array<char, TileSize * TileSize>;  // row-major
+
+    TiledGrid(int width, int height)
+        : m_width(width), m_height(height),
+          m_tile_cols((width + TileSize - 1) / TileSize),
+          m_tile_rows((height + TileSize - 1) / TileSize),
+          m_tiles(size_t(m_tile_cols) * m_tile_rows) {
+        if (width < 1 || height < 1) throw std::invalid_argument("Bad grid size");
+    }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int tile_cols() const { return m_tile_cols; }
+    int tile_rows() const { return m_tile_rows; }
+
+    char at(int row, int col) const {
+        const Tile* t = tile(row >> TileBits, col >> TileBits);
+        return t ? (*t)[offset(row, col)] : Empty;
+    }
+    bool empty(int row, int col) const { return at(row, col) == Empty; }
+    void set(int row, int col, char ch) { write(row >> TileBits, col >> TileBits)[offset(row, col)] = ch; }
+
+    // The tile, nullptr if it was never written.
+    const Tile* tile(int trow, int tcol) const { return m_tiles[size_t(trow) * m_tile_cols + tcol].get(); }
+    // The tile, allocated (empty) if needed.
+    Tile& write(int trow, int tcol) {
+        auto& t = m_tiles[size_t(trow) * m_tile_cols + tcol];
+        if (!t) {
+            t = std::make_unique<Tile>();
+            t->fill(Empty);
+        }
+        return *t;
+    }
+    // Frees the tile; it reads as empty again.
+    void clear(int trow, int tcol) { m_tiles[size_t(trow) * m_tile_cols + tcol].reset(); }
+
+    size_t tiles_allocated() const {
+        return std::count_if(m_tiles.begin(), m_tiles.end(), [](const auto& t) { return t != nullptr; });
+    }
+
+    // Copies the grid into a puzzle of the same size.
+    void copy_to(Puzzle& puzzle) const {
+        puzzle = Puzzle(m_width, m_height);
+        for (int trow = 0; trow < m_tile_rows; ++trow)
+            for (int tcol = 0; tcol < m_tile_cols; ++tcol) {
+                const Tile* t = tile(trow, tcol);
+                if (!t) continue;
+                const int row = trow * TileSize, col = tcol * TileSize;
+                const int cols = std::min(TileSize, m_width - col);
+                for (int r = 0; r < std::min(TileSize, m_height - row); ++r)
+                    std::copy(t->data() + r * TileSize, t->data() + r * TileSize + cols,
+                              puzzle[row + r] + col);
+            }
+    }
+
+private:
+    static size_t offset(int row, int col)
+        { return size_t(row & (TileSize - 1)) * TileSize + (col & (TileSize - 1)); }
+
+    int m_width, m_height;
+    int m_tile_cols, m_tile_rows;
+    std::vector<std::unique_ptr<Tile>> m_tiles;  // row-major, nullptr: empty tile
+};
+
+#endif // TILED_GRID_H
@@ -0,0 +1,361 @@
+/*
+The weight approach (formerly crossword_puzzle_generator_dhayden.cpp).
+
+Words are drawn at random and each one is placed where it crosses the most
+letters already on the grid (see Cwg::highestWeight()), alternating between
+horizontal and vertical words. A word which doesn't fit anywhere is dropped.
+
+A round adds at most two words of GeneratorParams::longest letters, so with
+GeneratorParams::beat set a generation gives up once its letters plus that
+for the rounds left don't beat it.
+*/
+
+#ifndef WEIGHT_GENERATOR_H
+#define WEIGHT_GENERATOR_H
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "flat_grid.h"
+#include "generator.h"
+#include "instrumentation.h"
+#include "occupancy.h"
+#include "word_list.h"
+
+/* Holds its coordinates and a 'weight'.
+ * If the word doesn't fit in the grid, weight is -1.
+ * If the word fit, but there are no intersections with characters of other words, weight is 0.
+ * If the word fit, and there are intersections with characters of other words, weight is the
+ * sum of all intersected characters.
+ */
+struct Weight
+{
+    int x;   // column
+    int y;   // row
+    int wt;  // weight
+    Weight(int xx=0, int yy=0, int ww=0)
+    : x{xx}, y{yy}, wt{ww}
+    {}
+};
+
+/* The crossword puzzle generator class :-)
+ * Its grid at each border side is at each one field broader than its 'box' inside. That's for
+ * easier testing the borders of the words.
+ */
+class Cwg
+{
+public:
+    Cwg( int width, int height );
+    Cwg();
+
+    bool emplaceWord( std::string_view word, bool horizontally );
+    void copyTo( Puzzle & puzzle ) const;
+    int letters() const { return m_letters; }
+
+    /* Undo support: checkpoint() starts logging the cells written by
+     * emplaceWord() and returns the current position within the log,
+     * rollback() empties these cells again, back to the checkpoint.
+     * commit() stops logging and drops the log. A Snapshot is a flat copy
+     * of the whole grid, restore() copies it back without allocating.
+     */
+    struct Snapshot {
+        FlatGrid grid;
+        Occupancy occ;
+        int letters;
+    };
+    size_t checkpoint() { m_logging = true; return m_undo.size(); }
+    void rollback( size_t checkpoint );
+    void commit() { m_logging = false; m_undo.clear(); }
+    Snapshot snapshot() const { return Snapshot{ m_grid, m_occ, m_letters }; }
+    void restore( const Snapshot & s )
+        { m_grid = s.grid; m_occ = s.occ; m_letters = s.letters; m_undo.clear(); }
+
+    Weight highestWeight( std::string_view word, int dx, int dy ) const;
+    Weight doWeight( std::string_view word, int width, int height,
+		     int dx, int dy ) const;
+
+private:
+
+    // short-hand for the width and height
+    unsigned width() const {return m_grid.width(); }
+    unsigned height() const {return m_grid.height(); }
+
+    FlatGrid m_grid;         // m_grid[row][col]
+    Occupancy m_occ;         // occupied cells of m_grid, for grids up to 64x64
+    std::vector<uint32_t> m_undo;  // cells written since the first checkpoint, row * width + col
+    bool m_logging = false;
+    int m_letters = 0;             // letter cells
+    friend std::ostream & operator<<( std::ostream &, const Cwg & );
+};
+
+// Consider that the 'effective' room is width x height, at minimum 3 x 3.
+inline
+Cwg::Cwg( int width, int height )
+: m_grid{ std::max(width, 3), std::max(height, 3) }
+, m_occ{ std::max(width, 3), std::max(height, 3) }
+{}
+inline Cwg::Cwg() : Cwg{16,16} {}
+
+// Set dx and dy to increment one position horizontally or
+// vertically, depending on horizontal
+inline void setDeltas(bool horizontal, int &dx, int &dy)
+{
+    if (horizontal) {
+	dx = 1;
+	dy = 0;
+    } else {
+	dx = 0;
+	dy = 1;
+    }
+}
+
+/* This method emplaces a word on the grid depending on the return value of Cwg::highestWeight().
+ * The word will positioned at the coordinates of that Weight object.
+ * If no position could found, the method returns false, otherwise true.
+ *
+ * See also Cwg::doWeight()
+ */
+inline bool
+Cwg::emplaceWord( std::string_view word, bool horizontally = true )
+{
+    int dx, dy;
+    setDeltas(horizontally, dx, dy);
+    // check that the word is not too long for the grid
+    if (word.length()*dx > width()-2 || word.length()*dy > height()-2) {
+	CWG_COUNT( WeightWordsDropped );
+	return false;
+    }
+
+    Weight weight = highestWeight( word, dx, dy);
+    //std::cerr << word << ':' << '(' << weight.x << ',' << weight.y << ','
+    //          << weight.wt << ')'<< '\n';
+    if( weight.wt == -1 ) {
+        CWG_COUNT( WeightWordsDropped );
+        return false;   // word doesn't match within the grid
+    }
+    CWG_COUNT( WeightWordsPlaced );
+
+    // Place it
+    // std::cout << "Emplace " << word << ' '
+    // << (horizontally ? "horizontal" : "vertical")
+    // << " at " << weight.x+1 << ',' << weight.y+1 << '\n';
+    for( unsigned p = 0; p < word.length(); ++p) {
+	if( m_grid[weight.y][weight.x] == FlatGrid::Empty ) {
+	    ++m_letters;
+	    if( m_logging ) m_undo.push_back( weight.y * width() + weight.x );
+	}
+	m_grid.set( weight.y, weight.x, word[p] );
+	if( m_occ.enabled() ) m_occ.set( weight.y, weight.x );
+	weight.x += dx;
+	weight.y += dy;
+    }
+
+    //std::cerr << *this << '\n';
+    return true;
+}
+
+/* This method returns the position for a word at the grid with the highest weight.
+ * See Cwg::doWeight()
+ *
+ * Consider that the the there is a border of 1 field at each side of the grid.
+ *
+ * If the CPU supports it, the whole grid is searched by the vectorized
+ * FlatGrid::best(), which returns the same position as the scan below.
+ */
+inline Weight
+Cwg::highestWeight( std::string_view word, int dx, int dy) const
+{
+    CWG_TIME( HighestWeight );
+    CWG_COUNT( HighestWeightCalls );
+    CWG_COUNT_N( WeightPositions, ( height() - dy*word.size() - 2 ) * ( width() - dx*word.size() - 2 ) );
+    if( FlatGrid::simd() ) {
+        FlatGrid::Best best = m_grid.best( word, dx == 1,
+                                           1, height() - dy*word.size() - 1,
+                                           1, width() - dx*word.size() - 1 );
+        return best.wt == -1 ? Weight(1,1,-1) : Weight(best.x, best.y, best.wt);
+    }
+
+    Weight weight(1,1,-1);
+
+    for( unsigned h = 1; h < height() - dy*word.size() - 1; ++h ) {
+	for( unsigned w = 1; w < width() - dx*word.size() - 1; ++w ) {
+	    Weight tmpWeight = doWeight( word, w, h, dx, dy);
+	    if( tmpWeight.wt > weight.wt ) {
+		weight = tmpWeight;
+	    }
+	}
+    }
+
+    //std::cerr << "x("<< weight.x <<','<< weight.y <<','<< weight.wt <<')';
+    return weight;
+}
+
+
+/* This method tests if a word matches within a distinct grid position.
+ * If the word fits into the position, it returns by default a weight of 0.
+ * For each matching intersection with another word the weight increases by 1.
+ * If the word doesn't match at the position, the weight gets -1.
+ */
+inline Weight
+Cwg::doWeight( std::string_view word, int width, int height,
+	       int dx, int dy) const
+{
+    // Each word needs at minimum a distance by one field in each direction to its neighbours.
+
+    Weight weight(width,height,0);  // Needs to be 0 weighted!
+
+    // On the bitboards the free cells and their neighbours are tested at once,
+    // only the already occupied cells need to be compared letter by letter.
+    if( m_occ.enabled() ) {
+        const bool horz = dx == 1;
+        const int line = horz ? height : width;
+        const int start = horz ? width : height;
+        uint64_t filled = m_occ.line( horz, line )
+                        & Occupancy::span( start, word.size() );
+        if( !m_occ.span_free( horz, line, start, word.size(), filled ) ) {
+            weight.wt = -1;
+            return weight;
+        }
+        for( ; filled; filled &= filled - 1 ) {
+            int p = __builtin_ctzll( filled ) - start;
+            if( m_grid[height + dy*p][width + dx*p] != word[p] ) {
+                weight.wt = -1;
+                return weight;
+            }
+            ++weight.wt;
+        }
+        return weight;
+    }
+
+    // Are there blank spaces before and after the word?
+    if (m_grid[height-dy][width-dx] != '.' ||
+	m_grid[height+dy*word.size()][width+dx*word.size()] != '.') {
+	weight.wt = -1;
+	//	std::cout << "Can't place at " << width+1 << "," << height+1
+	// << ": No blank before or after\n";
+	return weight;
+    }
+
+    for( unsigned p = 0; p < word.length(); ++p, height += dy, width += dx ) {
+            // test the place as such
+	char g = m_grid[height][width]; // shorthand
+	if( word[p] == g) {
+	    // It matches
+	    ++weight.wt;
+	    continue;
+	} else if( g != '.') {
+	    // That space is occupied. Technically the
+	    // comparison below will catch this case
+	    // also, but what the heck.
+	    weight.wt = -1;
+	    // std::cout << "Can't place " << word << ' ' << p
+	    // << " at " << ow+1 << "," << oh+1
+	    // << ": " << width+1 << "," << height+1
+	    // << " is " << g << " instead of " << word[p] << '\n';
+	    break;
+	} else if (m_grid[height+dx][width] != '.' ||
+		   m_grid[height][width+dy] != '.' ||
+		   m_grid[height-dx][width] != '.' ||
+		   m_grid[height][width-dy] != '.') {
+	    // neighboring cell is occupied
+	    // std::cout << "Can't place at " << ow+1 << "," << oh+1
+	    // << ": adjacent space is occupied\n";
+	    weight.wt = -1;
+	    break;
+	}
+    }
+    //std::cerr << '('<<weight.x<<','<<weight.y<<','<<weight.wt<<')';  // correct
+    return weight;
+}
+
+/* Overloads operator<< at std::ostream for << the grid.
+ * The grid is formatted into one string and written at once.
+ */
+inline std::ostream & operator<<( std::ostream & os, const Cwg & cwg )
+{
+    std::string text;
+    text.reserve( ( 2 * cwg.width() + 1 ) * cwg.height() );
+    for( unsigned h = 0; h < cwg.height(); ++h ){
+        for( unsigned w = 0; w < cwg.width(); ++w ) {
+            const char c = cwg.m_grid[h][w];
+            text += ' ';
+            text += c=='.' ? ' ' : c;
+        }
+        text += '\n';
+    }
+    return os.write( text.data(), text.size() );
+}
+
+/* Empties the cells written since the checkpoint.
+ */
+inline void
+Cwg::rollback( size_t checkpoint )
+{
+    for( ; m_undo.size() > checkpoint; m_undo.pop_back() ) {
+        const int row = m_undo.back() / width(), col = m_undo.back() % width();
+        m_grid.set( row, col, FlatGrid::Empty );
+        if( m_occ.enabled() ) m_occ.reset( row, col );
+        --m_letters;
+    }
+}
+
+/* Copies the grid, border included, to the puzzle.
+ */
+inline void
+Cwg::copyTo( Puzzle & puzzle ) const
+{
+    puzzle = Puzzle( width(), height() );
+    for( unsigned h = 0; h < height(); ++h )
+        std::copy( m_grid[h], m_grid[h] + width(), puzzle[h] );
+}
+
+
+class WeightGenerator : public Generator
+{
+public:
+    explicit WeightGenerator( const WordList & wordlist ) : m_words( wordlist ) {}
+
+    const char * name() const override { return "weight"; }
+
+    /* The grid includes Cwg's border, so its 'effective' room is
+     * (width-2) x (height-2).
+     */
+    bool generate( const GeneratorParams & params, GeneratorRng & rng,
+                   Puzzle & puzzle ) const override
+    {
+        if( params.width < 3 || params.height < 3 || params.shortest > params.longest )
+            throw std::invalid_argument( "Bad grid or word size" );
+        CWG_TIME( WeightGenerate );
+        CWG_COUNT( WeightGenerations );
+        const int rounds = params.rounds > 0 ? params.rounds
+                                             : params.width * params.height / 9;
+        const long cells = long( params.width ) * params.height;
+        Cwg cwg{ params.width, params.height };
+        for( int i = 0; i < rounds; ++i )
+        {
+            const long most = cwg.letters() + 2L * params.longest * ( rounds - i );
+            if( params.cancelled() || params.beaten( int( std::min( most, cells ) ) ) )
+            {
+                cwg.copyTo( puzzle );
+                return false;
+            }
+            uint32_t hor, vert;
+            if( !m_words.rnd_word( rng, params.shortest, params.longest, hor )
+             || !m_words.rnd_word( rng, params.shortest, params.longest, vert ) )
+                break;
+            cwg.emplaceWord( m_words.word_view(hor), true );
+            cwg.emplaceWord( m_words.word_view(vert), false );
+        }
+        cwg.copyTo( puzzle );
+        return true;
+    }
+
+private:
+    const WordList & m_words;
+};
+
+#endif // WEIGHT_GENERATOR_H
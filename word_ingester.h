@@ -0,0 +1,260 @@
+/*
+Streaming ingestion of word lists for index_adder.
+
+The input is read in chunks cut at line boundaries, and the chunks are
+normalized on a WorkStealingPool: every whitespace separated word is
+uppercased, checked against the length bounds and sorted into its length
+bucket. The chunks' buckets are appended to the result in input order, so
+the output doesn't depend on the thread count.
+
+A line of a word and a number gives the word's weight (see word_list.h); a
+weight of 0 drops the word. Once any line has a weight, weights() holds one
+per word of each bucket, 1 for words without.
+
+At most two chunks per thread are in flight, so besides the result (the
+words themselves, packed) memory stays bounded however large the input is.
+A bucket holds its words back to back without separators, since all of them
+have the bucket's length; that's also the layout of a binary dictionary
+(see binary_dictionary.h).
+
+Words with other characters than A-Z are handled by NonAlpha:
+
+ Abort         : throws std::runtime_error (what index_adder always did)
+ Drop          : skips the word
+ Transliterate : replaces Latin letters with diacritics, given as UTF-8
+                 (Latin-1 Supplement and Latin Extended-A), by their base
+                 letters (e.g. "Ä" -> "A", "ß" -> "SS", "Œ" -> "OE"); a word
+                 still not alphabetic after that is dropped
+*/
+
+#ifndef WORD_INGESTER_H
+#define WORD_INGESTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "binary_dictionary.h"
+#include "work_stealing_pool.h"
+
+class WordIngester {
+public:
+    enum NonAlpha { Abort, Drop, Transliterate };
+
+    struct Options {
+        int shortest = 1, longest = DictMaxWordLength;
+        NonAlpha non_alpha = Abort;
+        size_t chunk_size = 4 << 20;
+        unsigned threads = std::thread::hardware_concurrency();
+    };
+
+    struct Stats {
+        uint64_t words = 0;           // read
+        uint64_t kept = 0;            // put into a bucket
+        uint64_t non_alpha = 0;       // dropped for other characters than A-Z
+        uint64_t transliterated = 0;  // kept after transliteration
+        uint64_t out_of_range = 0;    // dropped for their length
+        uint64_t banned = 0;          // dropped for weight 0
+
+        void add(const Stats& s) {
+            words += s.words; kept += s.kept; non_alpha += s.non_alpha;
+            transliterated += s.transliterated; out_of_range += s.out_of_range;
+            banned += s.banned;
+        }
+    };
+
+    explicit WordIngester(const Options& options) : m_options(options) {
+        m_options.shortest = std::max(m_options.shortest, 1);
+        m_options.longest  = std::min(m_options.longest, DictMaxWordLength);
+        m_options.chunk_size = std::max<size_t>(m_options.chunk_size, 1);
+        m_buckets.resize(DictMaxWordLength);
+    }
+
+    // Reads all words of 'in'; may be called for several inputs.
+    void ingest(std::istream& in) {
+        std::vector<Chunk> chunks;  // outlives the pool, whose jobs point into it
+        WorkStealingPool pool(std::max(m_options.threads, 1u));
+        const size_t window = 2 * pool.size();
+        chunks.reserve(window);
+        std::string carry;
+        for (bool more = true; more; ) {
+            std::string text = std::move(carry);
+            carry.clear();
+            const size_t old = text.size();
+            text.resize(old + m_options.chunk_size);
+            in.read(&text[old], m_options.chunk_size);
+            text.resize(old + in.gcount());
+            more = bool(in);
+            if (more) {
+                // the last line goes into the next chunk (unless there is no line break at all)
+                size_t end = text.rfind('\n');
+                if (end != std::string::npos) {
+                    carry.assign(text, end + 1, std::string::npos);
+                    text.resize(end + 1);
+                }
+                else {
+                    carry = std::move(text);
+                    continue;
+                }
+            }
+            if (text.empty()) continue;
+
+            chunks.emplace_back();
+            chunks.back().text = std::move(text);
+            Chunk* chunk = &chunks.back();
+            pool.submit([this, chunk] { normalize_chunk(*chunk); });
+            if (chunks.size() == window) {
+                pool.wait();
+                for (auto& c : chunks) merge(c);
+                chunks.clear();
+            }
+        }
+        // the last read may come back empty, e.g. if the input size is a multiple of the chunk size
+        pool.wait();
+        for (auto& c : chunks) merge(c);
+    }
+
+    // buckets()[i] holds the words of length i+1, back to back.
+    const std::vector<std::string>& buckets() const { return m_buckets; }
+    // weights()[i] holds the weights of buckets()[i]'s words; empty without weights.
+    const std::vector<std::vector<float>>& weights() const { return m_weights; }
+    const Stats& stats() const { return m_stats; }
+
+    /* Normalizes one word into 'out' (uppercase A-Z). Returns false if the
+     * word is to be dropped; throws for Abort.
+     */
+    static bool normalize(std::string_view word, NonAlpha non_alpha, std::string& out,
+                          bool& transliterated) {
+        out.clear();
+        transliterated = false;
+        for (size_t i = 0; i < word.size(); ++i) {
+            unsigned char ch = word[i];
+            if (ch >= 'a' && ch <= 'z') out += char(ch - 'a' + 'A');
+            else if (ch >= 'A' && ch <= 'Z') out += char(ch);
+            else if (non_alpha == Transliterate && (ch & 0xe0) == 0xc0 && i + 1 < word.size()
+                  && (static_cast<unsigned char>(word[i + 1]) & 0xc0) == 0x80) {
+                unsigned code = (ch & 0x1f) << 6 | (static_cast<unsigned char>(word[i + 1]) & 0x3f);
+                const char* base = base_letters(code);
+                if (!base) return false;
+                out += base;
+                transliterated = true;
+                ++i;
+            }
+            else if (non_alpha == Abort)
+                throw std::runtime_error("The dictionary contains non-alphabetic stuff: "
+                                         + std::string(word));
+            else return false;
+        }
+        return true;
+    }
+
+private:
+    struct Chunk {
+        std::string text;
+        std::vector<std::string> buckets;
+        std::vector<std::vector<float>> weights;  // empty until a line has a weight
+        Stats stats;
+    };
+
+    // Gives every word of 'buckets' without a weight weight 1.
+    static void fill_weights(const std::vector<std::string>& buckets,
+                             std::vector<std::vector<float>>& weights) {
+        weights.resize(buckets.size());
+        for (size_t i = 0; i < buckets.size(); ++i)
+            weights[i].resize(buckets[i].size() / (i + 1), 1);
+    }
+
+    void normalize_chunk(Chunk& chunk) const {
+        chunk.buckets.resize(DictMaxWordLength);
+        std::string word;
+        const std::string_view text = chunk.text;
+        std::vector<std::string_view> tokens;  // of a line
+        for (size_t line = 0, end; line < text.size(); line = end + 1) {
+            end = std::min(text.find('\n', line), text.size());
+            tokens.clear();
+            for (size_t i = line; i < end; ) {
+                while (i < end && is_space(text[i])) ++i;
+                size_t start = i;
+                while (i < end && !is_space(text[i])) ++i;
+                if (i > start) tokens.push_back(text.substr(start, i - start));
+            }
+            float weight = 1;
+            if (tokens.size() == 2 && dict_parse_weight(tokens[1], weight)) {
+                tokens.pop_back();
+                if (chunk.weights.empty()) fill_weights(chunk.buckets, chunk.weights);
+            }
+            for (auto token : tokens) {
+                ++chunk.stats.words;
+                bool transliterated;
+                if (!normalize(token, m_options.non_alpha, word, transliterated)) {
+                    ++chunk.stats.non_alpha;
+                    continue;
+                }
+                if (int(word.size()) < m_options.shortest || int(word.size()) > m_options.longest) {
+                    ++chunk.stats.out_of_range;
+                    continue;
+                }
+                if (weight == 0) {
+                    ++chunk.stats.banned;
+                    continue;
+                }
+                chunk.stats.transliterated += transliterated;
+                ++chunk.stats.kept;
+                chunk.buckets[word.size() - 1] += word;
+                if (!chunk.weights.empty()) chunk.weights[word.size() - 1].push_back(weight);
+            }
+        }
+        chunk.text = std::string();  // done with the input
+    }
+
+    void merge(Chunk& chunk) {
+        if (!chunk.weights.empty() && m_weights.empty()) fill_weights(m_buckets, m_weights);
+        if (!m_weights.empty() && chunk.weights.empty()) fill_weights(chunk.buckets, chunk.weights);
+        for (size_t i = 0; i < m_buckets.size(); ++i) {
+            m_buckets[i] += chunk.buckets[i];
+            if (!m_weights.empty())
+                m_weights[i].insert(m_weights[i].end(), chunk.weights[i].begin(),
+                                    chunk.weights[i].end());
+        }
+        m_stats.add(chunk.stats);
+    }
+
+    static bool is_space(char ch)
+        { return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f'; }
+
+    // The base letters of a Latin letter with diacritics, U+00C0 .. U+017F; nullptr for others.
+    static const char* base_letters(unsigned code) {
+        static const char* const latin1[32] = {
+            "A", "A", "A", "A", "A", "A", "AE", "C", "E", "E", "E", "E", "I", "I", "I", "I",
+            "D", "N", "O", "O", "O", "O", "O", nullptr, "O", "U", "U", "U", "U", "Y", "TH", "SS" };
+        if (code >= 0xc0 && code < 0xe0) return latin1[code - 0xc0];
+        if (code >= 0xe0 && code < 0x100) return code == 0xff ? "Y" : latin1[code - 0xe0];
+        // Latin Extended-A: first code point of each base letter
+        static const struct { unsigned first; const char* base; } extended[] = {
+            { 0x100, "A" }, { 0x106, "C" }, { 0x10e, "D" }, { 0x112, "E" }, { 0x11c, "G" },
+            { 0x124, "H" }, { 0x128, "I" }, { 0x132, "IJ" }, { 0x134, "J" }, { 0x136, "K" },
+            { 0x139, "L" }, { 0x143, "N" }, { 0x14c, "O" }, { 0x152, "OE" }, { 0x154, "R" },
+            { 0x15a, "S" }, { 0x162, "T" }, { 0x168, "U" }, { 0x174, "W" }, { 0x176, "Y" },
+            { 0x179, "Z" }, { 0x17f, "S" }, { 0x180, nullptr } };
+        if (code < 0x100 || code >= 0x180) return nullptr;
+        const char* base = nullptr;
+        for (const auto& e : extended) {
+            if (e.first > code) break;
+            base = e.base;
+        }
+        return base;
+    }
+
+    Options m_options;
+    std::vector<std::string> m_buckets;
+    std::vector<std::vector<float>> m_weights;
+    Stats m_stats;
+};
+
+#endif // WORD_INGESTER_H
@@ -0,0 +1,303 @@
+/*
+The dictionary as used by the generators: all words within a length range of
+a text file, a binary dictionary (see binary_dictionary.h) or a DAWG (see
+dawg.h), together with their pattern index (see pattern_index.h).
+
+Words are referred to by ids 0 .. size()-1. Like in a binary dictionary the
+ids are sorted by word length, so the words of any length range have
+contiguous ids (see range()), and all words are uppercase. The words of a
+text file or a DAWG are kept in one character pool, so all words are handed
+out as string_views, and a word is only copied into a string by word().
+
+Words may carry weights (e.g. frequencies or editor scores): in a text file
+as second column ("WORD 120"), in a binary dictionary as its weight section.
+A weight of 0 bans a word, it isn't loaded at all. With weights, all draws
+(rnd_word() and pick()) are proportional to them: rnd_word() takes a length
+by the lengths' total weights and then a word of that length from the
+length's alias table (alias_table.h), pick() see pattern_index.h. Without
+weights the draws stay plain uniform ones.
+
+A WordList is read-only after construction, so one instance can be shared by
+any number of threads; the random draws take the caller's engine. With
+enable_cache(), pattern queries go through a PatternCache (pattern_cache.h)
+shared by these threads; it draws the same words, only faster once the
+patterns repeat, as they do in the fill's forward checking (fill_engine.h).
+*/
+
+#ifndef WORD_LIST_H
+#define WORD_LIST_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "alias_table.h"
+#include "binary_dictionary.h"
+#include "dawg.h"
+#include "instrumentation.h"
+#include "pattern_cache.h"
+#include "pattern_index.h"
+#include "rng.h"
+
+class WordList {
+public:
+    /* With 'verify' the checksum of a binary dictionary or DAWG is checked as
+     * well, which reads the whole file.
+     */
+    WordList(const std::string& filename, int shortest, int longest, bool verify = false) {
+        CWG_TIME(LoadWordList);
+        if (MappedDictionary::is_binary(filename)) {
+            // words of a length range have contiguous ids, so no filtering needed
+            m_dict = std::make_unique<MappedDictionary>(filename, verify);
+            auto range = m_dict->range(shortest, longest);
+            m_first = range.first;
+            m_size  = range.second - range.first;
+            if (m_dict->weights()) m_weight_data = m_dict->weights() + m_first;
+        }
+        else if (Dawg::is_dawg(filename)) {
+            load_dawg(filename, shortest, longest, verify);
+            m_size = m_refs.size();
+        }
+        else {
+            load_text(filename, shortest, longest);
+            m_size = m_refs.size();
+            if (!m_weights.empty()) m_weight_data = m_weights.data();
+        }
+        if (m_size == 0) throw std::runtime_error("No usable words in " + filename);
+        for (uint32_t id = 0; id < m_size; ++id) {
+            size_t len = word_view(id).size();
+            if (len >= m_length_first.size()) m_length_first.resize(len + 1, id);
+        }
+        m_length_first.push_back(m_size);
+        auto word_at = [this](uint32_t id) { return word_view(id); };
+        if (weighted()) {
+            build_alias_tables();
+            m_index = std::make_unique<PatternIndex>(m_size, word_at,
+                          [this](uint32_t id) { return weight(id); });
+        }
+        else m_index = std::make_unique<PatternIndex>(m_size, word_at);
+    }
+
+    uint32_t size() const { return m_size; }
+
+    std::string word(uint32_t id) const { return std::string(word_view(id)); }
+    std::string_view word_view(uint32_t id) const {
+        if (m_dict) return m_dict->word(m_first + id);
+        return { m_pool.data() + m_refs[id].offset, m_refs[id].length };
+    }
+
+    // Returns the ids [first, last) of all words with shortest <= length <= longest.
+    std::pair<uint32_t, uint32_t> range(int shortest, int longest) const {
+        auto first_of = [this](int len) {
+            return len < 1 ? 0 : len < int(m_length_first.size()) ? m_length_first[len] : m_size;
+        };
+        uint32_t first = first_of(shortest), last = first_of(longest + 1);
+        return first < last ? std::make_pair(first, last) : std::make_pair(0u, 0u);
+    }
+
+    bool weighted() const { return m_weight_data != nullptr; }
+    float weight(uint32_t id) const { return m_weight_data ? m_weight_data[id] : 1; }
+
+    template <class Rng>
+    std::string_view rnd_word(Rng& rng) const {
+        if (weighted()) {
+            uint32_t id = 0;
+            rnd_word(rng, 1, int(m_length_first.size()), id);
+            return word_view(id);
+        }
+        return word_view(random_below(rng, m_size));
+    }
+
+    // Draws a random word with shortest <= length <= longest; false if there is none.
+    template <class Rng>
+    bool rnd_word(Rng& rng, int shortest, int longest, uint32_t& id) const {
+        auto [first, last] = range(shortest, longest);
+        if (first == last) return false;
+        if (weighted()) return rnd_weighted(rng, shortest, longest, id);
+        id = first + random_below(rng, last - first);
+        return true;
+    }
+
+    // Draws a random word matching 'pattern' (see PatternIndex).
+    template <class Rng>
+    bool pick(std::string_view pattern, Rng& rng, uint32_t& id) const {
+        if (cached(pattern)) return m_index->pick(*candidates(pattern), rng, id);
+        return m_index->pick(pattern, rng, id);
+    }
+
+    // Appends the ids of all words matching 'pattern' to 'ids'.
+    size_t match(std::string_view pattern, std::vector<uint32_t>& ids) const {
+        if (cached(pattern)) return m_index->match(*candidates(pattern), ids);
+        return m_index->match(pattern, ids);
+    }
+
+    size_t count(std::string_view pattern) const {
+        if (cached(pattern)) return candidates(pattern)->entries.size();
+        return m_index->count(pattern);
+    }
+
+    /* True if some word matches 'pattern', without listing the matches: on a
+     * DAWG by a walk which stops at the first match, else by the pattern
+     * index.
+     */
+    bool any(std::string_view pattern) const {
+        if (!m_dawg) return m_index->any(pattern);
+        const int len = pattern.size();
+        auto [first, last] = range(len, len);
+        return first < last && m_dawg->any(pattern);
+    }
+
+    /* Caches the matches of the patterns queried from now on, up to about
+     * max_bytes. Call it before sharing the WordList between threads.
+     * Patterns with a single fixed letter (or none) bypass the cache: the
+     * pattern index keeps their matches as they are.
+     */
+    void enable_cache(size_t max_bytes) { m_cache = std::make_unique<PatternCache>(max_bytes); }
+    // The cache, nullptr if not enabled.
+    const PatternCache* cache() const { return m_cache.get(); }
+
+private:
+    bool cached(std::string_view pattern) const {
+        if (!m_cache) return false;
+        int letters = 0;
+        for (char ch : pattern) letters += std::isalpha(static_cast<unsigned char>(ch)) != 0;
+        return letters > 1;
+    }
+
+    // The matches of 'pattern' from the cache, added on a miss.
+    PatternCache::Entry candidates(std::string_view pattern) const {
+        std::string key = PatternIndex::key(pattern);
+        if (auto entry = m_cache->find(key)) return entry;
+        return m_cache->insert(key, std::make_shared<const PatternIndex::Candidates>(
+                                        m_index->candidates(pattern)));
+    }
+
+    struct WordRef {
+        uint32_t offset, length;  // within m_pool
+    };
+
+    /* Reads the words of a text file into m_pool, uppercase and sorted by
+     * length, like the words of a binary dictionary. A line of a word and a
+     * number gives the word's weight; other lines are words only.
+     */
+    void load_text(const std::string& filename, int shortest, int longest) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open " + filename);
+        in.seekg(0, std::ios::end);
+        if (uint64_t(in.tellg()) > UINT32_MAX) throw std::runtime_error(filename + " is too large");
+        std::string text(size_t(in.tellg()), '\0');
+        in.seekg(0);
+        in.read(&text[0], text.size());
+
+        struct Word {
+            WordRef ref;  // within 'text'
+            float weight;
+        };
+        std::vector<Word> words;
+        size_t total = 0;
+        bool weighted = false;
+        auto add = [&](WordRef ref, float weight) {
+            if (int(ref.length) < shortest || int(ref.length) > longest) return;
+            for (size_t k = ref.offset; k < ref.offset + ref.length; ++k)
+                text[k] = std::toupper(static_cast<unsigned char>(text[k]));
+            words.push_back(Word{ ref, weight });
+            total += ref.length;
+        };
+        auto space = [&](size_t i) { return std::isspace(static_cast<unsigned char>(text[i])); };
+        std::vector<WordRef> tokens;  // of a line
+        for (size_t line = 0, end; line < text.size(); line = end + 1) {
+            end = std::min(text.find('\n', line), text.size());
+            tokens.clear();
+            for (size_t i = line; i < end; ) {
+                while (i < end && space(i)) ++i;
+                size_t start = i;
+                while (i < end && !space(i)) ++i;
+                if (i > start) tokens.push_back(WordRef{ uint32_t(start), uint32_t(i - start) });
+            }
+            float weight;
+            if (tokens.size() == 2 && dict_parse_weight(std::string_view(text).substr(
+                                          tokens[1].offset, tokens[1].length), weight)) {
+                weighted = true;
+                if (weight > 0) add(tokens[0], weight);
+            }
+            else
+                for (const auto& token : tokens) add(token, 1);
+        }
+        std::stable_sort(words.begin(), words.end(),
+            [](const Word& a, const Word& b) { return a.ref.length < b.ref.length; });
+
+        m_pool.reserve(total);
+        m_refs.reserve(words.size());
+        if (weighted) m_weights.reserve(words.size());
+        for (const auto& word : words) {
+            m_refs.push_back(WordRef{ uint32_t(m_pool.size()), word.ref.length });
+            m_pool.append(text, word.ref.offset, word.ref.length);
+            if (weighted) m_weights.push_back(word.weight);
+        }
+    }
+
+    /* Reads the words of a DAWG into m_pool, by length and alphabetically
+     * within; the automaton stays mapped for any().
+     */
+    void load_dawg(const std::string& filename, int shortest, int longest, bool verify) {
+        m_dawg = std::make_unique<Dawg>(filename, verify);
+        std::string pattern;
+        for (int len = std::max(shortest, 1); len <= std::min(longest, DawgMaxLength); ++len) {
+            pattern.assign(len, '?');
+            m_dawg->for_each_match(pattern, [&](std::string_view word) {
+                m_refs.push_back(WordRef{ uint32_t(m_pool.size()), uint32_t(len) });
+                m_pool += word;
+            });
+        }
+    }
+
+    void build_alias_tables() {
+        m_alias.resize(m_length_first.size() - 1);
+        m_mass_before.assign(m_length_first.size(), 0);
+        for (size_t len = 0; len + 1 < m_length_first.size(); ++len) {
+            uint32_t first = m_length_first[len], last = m_length_first[len + 1];
+            m_alias[len] = AliasTable(m_weight_data + first, last - first);
+            m_mass_before[len + 1] = m_mass_before[len] + m_alias[len].total();
+        }
+    }
+
+    // rnd_word() with weights: a length by its total weight, then a word of it.
+    template <class Rng>
+    bool rnd_weighted(Rng& rng, int shortest, int longest, uint32_t& id) const {
+        const int lengths = m_alias.size();
+        shortest = std::max(shortest, 0);
+        longest  = std::min(longest, lengths - 1);
+        const double low = m_mass_before[shortest], high = m_mass_before[longest + 1];
+        if (!(high > low)) return false;
+        double u = random_real(rng, low, high);
+        int len = shortest;
+        while (len < longest && (m_alias[len].size() == 0 || u >= m_mass_before[len + 1])) ++len;
+        if (m_alias[len].size() == 0) return false;
+        id = m_length_first[len] + m_alias[len](rng);
+        return true;
+    }
+
+    std::string m_pool;                       // the words of a text file, back to back
+    std::vector<WordRef> m_refs;
+    std::unique_ptr<MappedDictionary> m_dict; // set for binary dictionaries
+    std::unique_ptr<Dawg> m_dawg;             // set for DAWGs, see any()
+    std::unique_ptr<PatternIndex> m_index;
+    std::unique_ptr<PatternCache> m_cache;    // shared by the threads, see enable_cache()
+    uint32_t m_first = 0, m_size = 0;
+    std::vector<uint32_t> m_length_first;     // id of the first word of each length
+    std::vector<float> m_weights;             // of a text file's words, if it has weights
+    const float* m_weight_data = nullptr;     // the weight of each id, nullptr without weights
+    std::vector<AliasTable> m_alias;          // per length
+    std::vector<double> m_mass_before;        // total weight of all shorter words
+};
+
+#endif // WORD_LIST_H
@@ -0,0 +1,176 @@
+/*
+A thread pool where each worker owns a job queue.
+
+A worker takes jobs from the back of its own queue and, when that runs dry,
+steals from the front of the other workers' queues, so uneven jobs (a puzzle
+may take much longer than the next one) keep all cores busy. Jobs submitted
+from outside the pool are spread round robin; jobs submitted by a worker go to
+its own queue.
+
+Jobs are coarse (a whole puzzle), so the queues are plain mutex-guarded deques.
+An exception thrown by a job is passed on by wait().
+
+A job may split itself up: it submits the parts to current_pool() and runs
+queued jobs by help_until() until its parts are done, so its worker is never
+idle and no extra threads are started (see tiled_generator.h).
+*/
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency()) {
+        if (threads == 0) threads = 1;
+        for (unsigned i = 0; i < threads; ++i)
+            m_queues.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threads; ++i)
+            m_threads.emplace_back([this, i] { work(i); });
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_work.notify_all();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    unsigned size() const { return m_queues.size(); }  // complete before any worker starts
+
+    // Index of the calling worker within its pool, or -1 outside of any pool.
+    static int worker_index() { return current().index; }
+    // The pool of the calling worker, or nullptr outside of any pool.
+    static WorkStealingPool* current_pool() { return current().pool; }
+
+    void submit(Job job) {
+        unsigned q = current().pool == this ? current().index
+                   : m_next.fetch_add(1, std::memory_order_relaxed) % size();
+        ++m_pending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_queued;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+            m_queues[q]->jobs.push_back(std::move(job));
+        }
+        m_work.notify_one();
+    }
+
+    // Blocks until all submitted jobs are done; rethrows the first job's exception.
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_pending == 0; });
+        if (m_error) {
+            auto error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    /* Runs queued jobs on the calling thread until done() is true, so a job
+     * can wait for the jobs it submitted. Other jobs may run meanwhile.
+     */
+    template <class Done>
+    void help_until(Done done) {
+        const unsigned self = current().pool == this ? current().index : 0;
+        while (!done()) {
+            Job job;
+            if (pop(self, job) || steal(self, job)) run(job);
+            else std::this_thread::yield();  // the last ones run elsewhere
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+    struct Worker {
+        WorkStealingPool* pool = nullptr;
+        int index = -1;
+    };
+
+    static Worker& current() {
+        thread_local Worker worker;
+        return worker;
+    }
+
+    bool pop(unsigned self, Job& job) {
+        auto& q = *m_queues[self];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty()) return false;
+        job = std::move(q.jobs.back());
+        q.jobs.pop_back();
+        --m_queued;
+        return true;
+    }
+
+    bool steal(unsigned self, Job& job) {
+        for (unsigned i = 1; i < size(); ++i) {
+            auto& q = *m_queues[(self + i) % size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.jobs.empty()) continue;
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            --m_queued;
+            return true;
+        }
+        return false;
+    }
+
+    void run(Job& job) {
+        try {
+            job();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) m_error = std::current_exception();
+        }
+        if (--m_pending == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.notify_all();
+        }
+    }
+
+    void work(unsigned self) {
+        current() = Worker{ this, int(self) };
+        for (;;) {
+            Job job;
+            if (pop(self, job) || steal(self, job)) {
+                run(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work.wait(lock, [this] { return m_stop || m_queued > 0; });
+            if (m_stop && m_queued <= 0) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_work, m_done;
+    std::atomic<long> m_queued{0};   // jobs within the queues
+    std::atomic<long> m_pending{0};  // jobs submitted but not finished
+    std::atomic<unsigned> m_next{0};
+    std::exception_ptr m_error;
+    bool m_stop = false;
+};
+
+#endif // WORK_STEALING_POOL_H